@@ -29,9 +29,37 @@
 
 #include "ansi.h"
 #include <Arduino.h>
+#include <string.h>
 
 static const char* CSI = "\e[";
 
+// sync() assembles the whole delta of a frame here and sends it with one write,
+// a full redraw of the usual screen fits, anything bigger goes out in chunks
+static char output[8192];
+static const int OUTPUT_CELL = 24; // cursor, color and glyph of one cell at most
+
+// UTF-8 of the C64 Pro font glyphs at 0xE000, the upper case set followed by the lower case set
+static char glyphs[512][3];
+
+static inline char* append(char* o, const char* s)
+{
+  while (*s) *o++ = *s++;
+  return o;
+}
+
+static inline char* append_cursor(char* o, int x, int y)
+{
+  *o++ = '\e';
+  *o++ = '[';
+  if (y>=10) *o++ = '0'+y/10;
+  *o++ = '0'+y%10;
+  *o++ = ';';
+  if (x>=10) *o++ = '0'+x/10;
+  *o++ = '0'+x%10;
+  *o++ = 'H';
+  return o;
+}
+
 const char* Ansi::Foreground[16] = {
       "\e[38;5;0m",// BLK
       "\e[38;5;15m",// WHT
@@ -114,6 +142,12 @@ int Ansi::read(Stream& _s)
 AnsiRenderer::AnsiRenderer()
 {
   uppercase = true;
+  char buf[5];
+  for (int i=0; i<512; ++i)
+  {
+    utf8_encode(buf,0xe000+i);
+    memcpy(glyphs[i],buf,3);
+  }
 }
 void Ansi::setCursor(int x, int y)
 {
@@ -187,27 +221,26 @@ int utf8_encode(char *out, uint32_t utf)
   }
 }
 
-void AnsiRenderer::sync(uint8_t *text, uint8_t *cram, uint8_t bgcolor)
+int AnsiRenderer::sync(uint8_t *text, uint8_t *cram, uint8_t bgcolor)
 {
-    int i = 0;
+    int changes = 0;
     if (text == 0)
-        return;
+        return 0;
     if (cram == 0)
-        return;
+        return 0;
     uint8_t *p = text;
     uint8_t *q = text_shadow;
     uint8_t *pc = cram;
     uint8_t *qc = cram_shadow;
 
-    uint32_t offset = 0xe000;
-    if (!uppercase)
-        offset += 0x100; // memorymap
+    const char (*set)[3] = uppercase ? glyphs : glyphs+0x100; // memorymap
+    char* o = output;
 
     if (bg != bgcolor)
     {
         invalidate(text, cram);
         bg = bgcolor;
-       setBackColor(bg & 15);
+        o = append(o,Background[bg & 15]);
     }
     int color = -1;
     for (int y = 1; y <= 25; ++y)
@@ -219,21 +252,27 @@ void AnsiRenderer::sync(uint8_t *text, uint8_t *cram, uint8_t bgcolor)
             {
                 *q = *p;
                 *qc = *pc;
+                if (o > output+sizeof(output)-OUTPUT_CELL)
+                {
+                    Serial.write((const uint8_t*)output,o-output);
+                    o = output;
+                }
                 if (cx != x)
                 {
-                    setCursor(x,y);
+                    o = append_cursor(o,x,y);
                     cx = x;
                 }
                 if (color != *pc)
                 {
                   color = *pc;
-                  setTextColor(*pc);
+                  o = append(o,Foreground[color & 15]);
                 }
-                uint8_t ch = *p;
-                char buf[6];
-                utf8_encode(buf, offset + ch);
-                Serial.print(buf);
+                const char* glyph = set[*p];
+                *o++ = glyph[0];
+                *o++ = glyph[1];
+                *o++ = glyph[2];
                 cx++;
+                changes++;
             }
             p++;
             q++;
@@ -241,4 +280,6 @@ void AnsiRenderer::sync(uint8_t *text, uint8_t *cram, uint8_t bgcolor)
             qc++;
         }
     }
+    if (o != output) Serial.write((const uint8_t*)output,o-output);
+    return changes;
 }
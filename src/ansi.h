@@ -98,7 +98,7 @@ public:
 
   AnsiRenderer();
   void invalidate(uint8_t* text, uint8_t* cram);
-  void sync(uint8_t* text, uint8_t* cram, uint8_t bgcolor);
+  int sync(uint8_t* text, uint8_t* cram, uint8_t bgcolor); // returns the number of cells sent
 };
 
 int utf8_encode(char *out, uint32_t utf);
@@ -38,6 +38,10 @@ public:
     virtual void reset() = 0;
     virtual void setup() = 0;
     virtual void clock() = 0;
+    // for the scheduler in loop(): clock() calls until the chip has something to tell the cpu,
+    // and n clock() calls at once when nothing happens in between
+    virtual uint32_t nextEvent() { return UINT32_MAX; }
+    virtual void advance(uint32_t n) { while (n--) clock(); }
     virtual uint8_t read(uint8_t adr) = 0;
     virtual void write(uint8_t adr, uint8_t value) = 0;
 };
@@ -46,6 +46,7 @@ void CIA::reset()
   ddrb = 0xaa;
   latchA = 0xFFFF;
   latchB = 0xFFFF;
+  update();
 }
 
 void CIA::nmi()
@@ -58,53 +59,96 @@ void CIA::setup()
 
 }
 
-void CIA::clock()
+// counts a running timer down by n cycles, returns true when it underflowed on the way
+static bool countdown(uint16_t& counter, uint16_t latch, uint8_t& cr, uint32_t n)
 {
+  uint32_t first = counter ? counter : 0x10000;
+  if (n<first)
+  {
+    counter -= n;
+    return false;
+  }
+  if (cr&8)  // timer stops after underflow
+  {
+    cr&=~1;  // stop timer
+    counter = 0;
+    return true;
+  }
+  // reloaded from the latch at the first underflow, and again every period cycles after that
+  uint32_t period = latch ? latch : 0x10000;
+  counter = latch - (n-first) % period;
+  return true;
+}
+
+uint32_t CIA::now()
+{
+  uint32_t t = following ? elapsed+(cpu.clockcycles-origin) : elapsed;
+  return (int32_t)(t-stamp)<0 ? stamp : t; // a cyclehack lets clockcycles outrun the budget
+}
+
+void CIA::update()
+{
+  uint32_t t = now();
+  uint32_t n = t-stamp;
+  stamp = t;
   bool irq = false;
-  if (cra&1)
+  if ((cra&1) && countdown(counterA,latchA,cra,n) && (imr&1))
   {
-    counterA--;
-    if (counterA==0)
-    {
-      if (cra&8)  // timer stops after underflow
-      {
-        cra&=~1;  // stop timer
-      }
-      else
-      {
-        counterA = latchA;
-      }
-      if (imr&1)
-      {
-        icr|=1; // flag interrupt 
-        irq = true;
-      }
-    }
+    icr|=1; // flag interrupt 
+    irq = true;
+  }
+  if ((crb&1) && countdown(counterB,latchB,crb,n) && (imr&2))
+  {
+    icr|=2; // flag interrupt 
+    irq = true;
   }
+  schedule();
 
-  if (crb&1)
+  if (irq) interrupt();
+}
+
+void CIA::schedule()
+{
+  // underflows without an irq are only seen through the registers, and those update() first
+  due = UINT32_MAX;
+  if ((cra&1) && (imr&1)) due = counterA ? counterA : 0x10000;
+  if ((crb&1) && (imr&2))
   {
-    counterB--;
-    if (counterB==0)
-    {
-      if (crb&8)  // timer stops after underflow
-      {
-        crb&=~1;  // stop timer
-      }
-      else
-      {
-        counterB = latchB;
-      }
-      if (imr&2)
-      {
-        icr|=2; // flag interrupt 
-        irq = true;
-      }
-    }
+    uint32_t b = counterB ? counterB : 0x10000;
+    if (b<due) due = b;
   }
+  // called right after update(), due counts from the instruction the cpu is executing
+  if (following && due!=UINT32_MAX) cpu.shorten(due);
+}
 
-  if (irq) cpu.irq();
-  // TODO: nmi
+uint32_t CIA::nextEvent()
+{
+  if (due==UINT32_MAX) return UINT32_MAX;
+  return due-(elapsed-stamp);
+}
+
+void CIA::advance(uint32_t n)
+{
+  following = false;
+  elapsed += n;
+  if (elapsed-stamp >= due) update();
+}
+
+uint8_t CIA::inspect(uint8_t adr)
+{
+  if (adr != ICR) return read(adr);
+  update();
+  return (icr & imr) ? (icr|0x80) : icr;
+}
+
+void CIA1::interrupt()
+{
+  cpu.setirq(MC6502::IRQ_CIA1, icr & imr);
+}
+
+void CIA2::interrupt()
+{
+  cpu.setnmi(MC6502::NMI_CIA2, icr & imr);
 }
 
 void CIA1::prefetch()
@@ -144,23 +188,31 @@ uint8_t CIA1::read(uint8_t adr)
     case DDRB:
       return ddrb;
     case TA_LO:
+      update();
       return counterA & 0xFF;
     case TA_HI:
+      update();
       return (counterA>>8) & 0xFF;
     case TB_LO:
+      update();
       return counterB & 0xFF;
     case TB_HI:
+      update();
       return (counterB>>8) & 0xFF;
     case ICR:
       {
+        update();
         uint8_t val = (icr & imr) ? (icr|0x80) : (icr);
         icr = 0;
+        interrupt();
         return val;
       }
     break;
     case CRA:
+      update();
       return cra;
     case CRB:
+      update();
       return crb;
     default:
     break;
@@ -186,19 +238,24 @@ void CIA1::write(uint8_t adr, uint8_t value)
       ddrb = value;
       return;
     case TA_LO:
+      update();
       latchA &= 0xFF00;
       latchA |= value;
       counterA &= 0xFF00;
       counterA |= value;
+      schedule();
       return;
     case TA_HI:
+      update();
       latchA &= 0x00FF;
       latchA |= value<<8;
       counterA &= 0x00FF;
       counterA |= value<<8;
+      schedule();
       return;
     case ICR:
     {
+      update();
       if ((value & 0x80) == 0x80)
       {
         imr |= (value & 0x1F);
@@ -207,14 +264,20 @@ void CIA1::write(uint8_t adr, uint8_t value)
       {
         imr &= ~(value & 0x1F);
       }
+      schedule();
+      interrupt();
     }
     return;
 
     case CRA:
+      update();
       cra = value;
+      schedule();
       return;
     case CRB:
+      update();
       crb = value;
+      schedule();
       return;
   }
 }
@@ -237,24 +300,32 @@ uint8_t CIA2::read(uint8_t adr)
     case DDRB:
       return ddrb;
     case TA_LO:
+      update();
       return counterA & 0xFF;
     case TA_HI:
+      update();
       return (counterA>>8) & 0xFF;
     case TB_LO:
+      update();
       return counterB & 0xFF;
     case TB_HI:
+      update();
       return (counterB>>8) & 0xFF;
 
     case ICR:
       {
+        update();
         uint8_t val = (icr & imr) ? (icr|0x80) : (icr);
         icr = 0;
+        interrupt();
         return val;
       }
     break;
     case CRA:
+      update();
       return cra;
     case CRB:
+      update();
       return crb;
     default:
     break;
@@ -282,19 +353,24 @@ void CIA2::write(uint8_t adr, uint8_t value)
       ddrb = value;
       return;
     case TA_LO:
+      update();
       latchA &= 0xFF00;
       latchA |= value;
       counterA &= 0xFF00;
       counterA |= value;
+      schedule();
       return;
     case TA_HI:
+      update();
       latchA &= 0x00FF;
       latchA |= value<<8;
       counterA &= 0x00FF;
       counterA |= value<<8;
+      schedule();
       return;
     case ICR:
     {
+      update();
       if ((value & 0x80) == 0x80)
       {
         imr |= (value & 0x1F);
@@ -303,14 +379,20 @@ void CIA2::write(uint8_t adr, uint8_t value)
       {
         imr &= ~(value & 0x1F);
       }
+      schedule();
+      interrupt();
     }
     return;
 
     case CRA:
+      update();
       cra = value;
+      schedule();
       return;
     case CRB:
+      update();
       crb = value;
+      schedule();
       return;
   }
 }
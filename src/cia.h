@@ -32,6 +32,7 @@
 
 #include <stdint.h>
 #include "chip.h"
+#include "cpu.h"
 
 class CIA : public Chip
 {
@@ -64,6 +65,7 @@ public:
   uint8_t cra;
   uint8_t crb;
 
+  // the counters hold their value at cycle "stamp", update() brings them up to "elapsed"
   uint16_t counterA;
   uint16_t counterB;
   uint16_t latchA;
@@ -75,23 +77,45 @@ public:
 
   void forceClock()
   {
+    update();
     counterA = 1;
     counterB = 1;
+    schedule();
     clock();
   }
 
-  uint32_t elapsed;
+  uint32_t elapsed; // cycles clocked so far
+  uint32_t stamp;   // now() at the last update()
+  uint32_t due;     // cycles after stamp until the next underflow that raises an irq
+  uint32_t origin;  // cpu.clockcycles at elapsed while following the cpu
+  bool following;
+
+  // the cpu runs next, lead cycles ahead of elapsed. Until the next clock() or advance() its
+  // clockcycles are the time of this cia, so register accesses see the cycle of their instruction
+  void follow(int32_t lead)
+  {
+    origin = cpu.clockcycles-lead;
+    following = true;
+  }
+  uint32_t now();
+  void update();
+  void schedule(); // a due earlier than the cpu's budget shortens run()
+  uint8_t inspect(uint8_t adr); // read() without acknowledging the interrupt
 
   virtual void reset();
-  virtual void clock();
+  virtual void clock() { advance(1); }
+  virtual uint32_t nextEvent(); // clock() calls until the next timer interrupt
+  virtual void advance(uint32_t n);
   virtual void setup();
   virtual void nmi();
+  virtual void interrupt() {} // drives the cpu line this cia is wired to from icr&imr
 
 };
 
 class CIA1 : public CIA
 {
 public:
+  virtual void interrupt();
   virtual uint8_t read(uint8_t adr);
   virtual void write(uint8_t adr, uint8_t value);
   virtual  void prefetch();
@@ -100,6 +124,7 @@ public:
 class CIA2 : public CIA
 {
 public:
+  virtual void interrupt();
   virtual uint8_t read(uint8_t adr);
   virtual void write(uint8_t adr, uint8_t value);
   virtual  void prefetch();
@@ -0,0 +1,307 @@
+/*
+ * Balster64, hacking a C64 emulator into an ESP32 microcontroller
+ *
+ * Copyright (C) Daniel Balster
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Daniel Balster nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY DANIEL BALSTER ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL DANIEL BALSTER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "condition.h"
+#include "cpu.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+struct Operator
+{
+    const char* token;
+    uint8_t op;
+    int level;
+};
+
+// binary operators from the lowest to the highest precedence, a longer token before its prefix
+static const Operator operators[] = {
+    { "|",  Condition::OR,  0 },
+    { "^",  Condition::XOR, 1 },
+    { "&",  Condition::AND, 2 },
+    { "==", Condition::EQ,  3 },
+    { "!=", Condition::NE,  3 },
+    { "=",  Condition::EQ,  3 },
+    { "<=", Condition::LE,  4 },
+    { ">=", Condition::GE,  4 },
+    { "<",  Condition::LT,  4 },
+    { ">",  Condition::GT,  4 },
+    { "+",  Condition::ADD, 5 },
+    { "-",  Condition::SUB, 5 },
+};
+static const int LEVELS = 6;
+
+static const struct
+{
+    const char* name;
+    uint8_t op;
+} names[] = {
+    { "a",    Condition::REG_A },
+    { "x",    Condition::REG_X },
+    { "y",    Condition::REG_Y },
+    { "sp",   Condition::REG_SP },
+    { "pc",   Condition::REG_PC },
+    { "p",    Condition::REG_P },
+    { "hits", Condition::HITS },
+};
+
+// recursive descent over the text, the scratch state of one compile()
+struct Parser
+{
+    const char* text;
+    const char* p;
+    int depth, maxdepth;
+    std::vector<uint8_t>& code;
+
+    Parser(const char* _text, std::vector<uint8_t>& _code) : text(_text), p(_text), depth(0), maxdepth(0), code(_code) {}
+
+    void skip();
+    bool accept(const char* token);
+    void emit(uint8_t op, int stack);
+    bool logicalOr();
+    bool logicalAnd();
+    bool binary(int level);
+    bool unary();
+    bool primary();
+};
+
+void Parser::skip()
+{
+    while (isspace(*p)) p++;
+}
+
+bool Parser::accept(const char* token)
+{
+    skip();
+    size_t n = strlen(token);
+    if (strncmp(p,token,n)) return false;
+    // "<" must not take the start of "<=", "&" not the start of "&&", but "!!" is two nots
+    if (n==1 && strchr("<>=!&|",*token) && p[1]=='=') return false;
+    if (n==1 && strchr("<>=&|",*token) && p[1]==*token) return false;
+    p += n;
+    return true;
+}
+
+void Parser::emit(uint8_t op, int stack)
+{
+    code.push_back(op);
+    depth += stack;
+    if (depth>maxdepth) maxdepth = depth;
+}
+
+bool Condition::compile(const char* text)
+{
+    code.clear();
+    Parser parser(text,code);
+    bool ok = parser.logicalOr();
+    parser.skip();
+    if (ok && *parser.p==0 && code.size()<CODE_SIZE && parser.maxdepth<=STACK_DEPTH)
+    {
+        parser.emit(END,0);
+        error = -1;
+        return true;
+    }
+    error = parser.p-text;
+    code.clear();
+    return false;
+}
+
+bool Parser::logicalOr()
+{
+    if (!logicalAnd()) return false;
+    while (accept("||"))
+    {
+        // a true left side is the result, else it is dropped and the right side decides
+        emit(Condition::JTRUE,-1);
+        size_t target = code.size();
+        code.push_back(0);
+        if (!logicalAnd()) return false;
+        code[target] = code.size();
+        emit(Condition::BOOL,0);
+    }
+    return true;
+}
+
+bool Parser::logicalAnd()
+{
+    if (!binary(0)) return false;
+    while (accept("&&"))
+    {
+        emit(Condition::JFALSE,-1);
+        size_t target = code.size();
+        code.push_back(0);
+        if (!binary(0)) return false;
+        code[target] = code.size();
+        emit(Condition::BOOL,0);
+    }
+    return true;
+}
+
+bool Parser::binary(int level)
+{
+    if (level==LEVELS) return unary();
+    if (!binary(level+1)) return false;
+    for (;;)
+    {
+        const Operator* o = nullptr;
+        for (const Operator& op : operators)
+        {
+            if (op.level==level && accept(op.token))
+            {
+                o = &op;
+                break;
+            }
+        }
+        if (o==nullptr) return true;
+        if (!binary(level+1)) return false;
+        emit(o->op,-1);
+    }
+}
+
+bool Parser::unary()
+{
+    if (accept("!"))
+    {
+        if (!unary()) return false;
+        emit(Condition::NOT,0);
+        return true;
+    }
+    if (accept("-"))
+    {
+        if (!unary()) return false;
+        emit(Condition::NEG,0);
+        return true;
+    }
+    if (accept("~"))
+    {
+        if (!unary()) return false;
+        emit(Condition::CPL,0);
+        return true;
+    }
+    return primary();
+}
+
+bool Parser::primary()
+{
+    skip();
+    if (accept("("))
+    {
+        return logicalOr() && accept(")");
+    }
+    if (*p=='$' || *p=='%' || isdigit(*p))
+    {
+        int base = 10;
+        if (*p=='$') base = 16;
+        if (*p=='%') base = 2;
+        if (base!=10) p++;
+        if (!isxdigit(*p)) return false;
+        char* end;
+        unsigned long value = strtoul(p,&end,base);
+        if (end==p || value>0xFFFF) return false;
+        p = end;
+        if (value<256)
+        {
+            emit(Condition::PUSH8,1);
+            code.push_back(value);
+        }
+        else
+        {
+            emit(Condition::PUSH16,1);
+            code.push_back(value & 0xFF);
+            code.push_back(value >> 8);
+        }
+        return true;
+    }
+    if (isalpha(*p))
+    {
+        const char* word = p;
+        while (isalnum(*p)) p++;
+        size_t n = p-word;
+        for (auto& name : names)
+        {
+            if (strlen(name.name)==n && !strncasecmp(word,name.name,n))
+            {
+                emit(name.op,1);
+                return true;
+            }
+        }
+        if (n==4 && !strncasecmp(word,"peek",4))
+        {
+            if (!accept("(") || !logicalOr() || !accept(")")) return false;
+            emit(Condition::PEEK,0);
+            return true;
+        }
+        p = word;
+    }
+    return false;
+}
+
+bool Condition::eval(const MC6502& cpu, uint32_t hits) const
+{
+    int32_t stack[STACK_DEPTH];
+    int32_t* s = stack-1;
+    const uint8_t* c = code.data();
+    for (;;)
+    {
+        switch (*c++)
+        {
+            case END:    return *s!=0;
+            case PUSH8:  *++s = *c++; break;
+            case PUSH16: *++s = c[0] | (c[1] << 8); c += 2; break;
+            case REG_A:  *++s = cpu.a; break;
+            case REG_X:  *++s = cpu.x; break;
+            case REG_Y:  *++s = cpu.y; break;
+            case REG_SP: *++s = cpu.sp; break;
+            case REG_PC: *++s = cpu.pc; break;
+            case REG_P:  *++s = cpu.flags(); break;
+            case HITS:   *++s = hits; break;
+            case PEEK:   *s = inspect(*s); break;
+            case NOT:    *s = !*s; break;
+            case NEG:    *s = -*s; break;
+            case CPL:    *s = ~*s; break;
+            case ADD:    s--; s[0] = s[0] + s[1]; break;
+            case SUB:    s--; s[0] = s[0] - s[1]; break;
+            case AND:    s--; s[0] = s[0] & s[1]; break;
+            case XOR:    s--; s[0] = s[0] ^ s[1]; break;
+            case OR:     s--; s[0] = s[0] | s[1]; break;
+            case EQ:     s--; s[0] = s[0] == s[1]; break;
+            case NE:     s--; s[0] = s[0] != s[1]; break;
+            case LT:     s--; s[0] = s[0] < s[1]; break;
+            case LE:     s--; s[0] = s[0] <= s[1]; break;
+            case GT:     s--; s[0] = s[0] > s[1]; break;
+            case GE:     s--; s[0] = s[0] >= s[1]; break;
+            case JFALSE: if (*s==0) c = code.data() + *c; else { c++; s--; } break;
+            case JTRUE:  if (*s!=0) c = code.data() + *c; else { c++; s--; } break;
+            case BOOL:   *s = *s!=0; break;
+            default:     return false;
+        }
+    }
+}
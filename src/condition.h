@@ -0,0 +1,68 @@
+/*
+ * Balster64, hacking a C64 emulator into an ESP32 microcontroller
+ *
+ * Copyright (C) Daniel Balster
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Daniel Balster nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY DANIEL BALSTER ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL DANIEL BALSTER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONDITION_H
+#define CONDITION_H
+
+#include <stdint.h>
+#include <vector>
+
+struct MC6502;
+
+/*
+    breakpoint conditions like "A>=$80 && peek($D012)==$30 && hits>100"
+
+    compiled once into a small stack bytecode, evaluated only when the address of the breakpoint is hit
+
+    operands:  A X Y SP PC P, hits, peek(address), numbers as $hex, %binary or decimal
+               peek() looks without side effects, the program runs the same with the condition armed
+    operators: ( ) ! ~ - + & ^ | == != < <= > >= && || with the precedence of C, = is the same as ==
+*/
+
+class Condition
+{
+public:
+    enum Op : uint8_t {
+        END, PUSH8, PUSH16, REG_A, REG_X, REG_Y, REG_SP, REG_PC, REG_P, HITS, PEEK,
+        NOT, NEG, CPL, ADD, SUB, AND, XOR, OR, EQ, NE, LT, LE, GT, GE,
+        JFALSE, JTRUE, BOOL, // short circuit for && and ||, the jump keeps the value on the stack
+    };
+    static const int STACK_DEPTH = 16;
+    static const int CODE_SIZE = 255; // jump targets are one byte
+
+    std::vector<uint8_t> code;
+    int error;  // offset of the character the compiler choked on, -1 when it compiled
+
+    Condition() : error(-1) {}
+    bool compile(const char* text);
+    bool eval(const MC6502& cpu, uint32_t hits) const;
+    bool empty() const { return code.empty(); }
+};
+
+#endif
@@ -9,78 +9,335 @@ https://github.com/dirkwhoffmann/virtualc64/blob/master/Emulator/CPU/CPUInstruct
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 
 #include "cpu.h"
+#include "memory.h"
 MC6502 cpu;
 
-// begin kernal patcher
+// the opcode table: opcode, operation, addressing mode, base cycles, +1 cycle when indexing crosses a page
+#define CPU_OPCODES(_) \
+    _(0x00, brk,     IMPLIED,     7, 0) \
+    _(0x01, ora,     INDIRECT_X,  6, 0) \
+    _(0x02, nop,     IMPLIED,     2, 0) \
+    _(0x03, slo,     INDIRECT_X,  8, 0) \
+    _(0x04, nop,     ZEROPAGE,    3, 0) \
+    _(0x05, ora,     ZEROPAGE,    3, 0) \
+    _(0x06, asl,     ZEROPAGE,    5, 0) \
+    _(0x07, slo,     ZEROPAGE,    5, 0) \
+    _(0x08, php,     IMPLIED,     3, 0) \
+    _(0x09, ora,     IMMEDIATE,   2, 0) \
+    _(0x0a, asl_a,   ACCUMULATOR, 2, 0) \
+    _(0x0b, nop,     IMMEDIATE,   2, 0) \
+    _(0x0c, nop,     ABSOLUTE,    4, 0) \
+    _(0x0d, ora,     ABSOLUTE,    4, 0) \
+    _(0x0e, asl,     ABSOLUTE,    6, 0) \
+    _(0x0f, slo,     ABSOLUTE,    6, 0) \
+    _(0x10, bpl,     RELATIVE,    2, 0) \
+    _(0x11, ora,     INDIRECT_Y,  5, 1) \
+    _(0x12, nop,     IMPLIED,     2, 0) \
+    _(0x13, slo,     INDIRECT_Y,  8, 0) \
+    _(0x14, nop,     ZEROPAGE_X,  4, 0) \
+    _(0x15, ora,     ZEROPAGE_X,  4, 0) \
+    _(0x16, asl,     ZEROPAGE_X,  6, 0) \
+    _(0x17, slo,     ZEROPAGE_X,  6, 0) \
+    _(0x18, clc,     IMPLIED,     2, 0) \
+    _(0x19, ora,     ABSOLUTE_Y,  4, 1) \
+    _(0x1a, nop,     IMPLIED,     2, 0) \
+    _(0x1b, slo,     ABSOLUTE_Y,  7, 0) \
+    _(0x1c, noP,     ABSOLUTE_X,  4, 1) \
+    _(0x1d, ora,     ABSOLUTE_X,  4, 1) \
+    _(0x1e, asl,     ABSOLUTE_X,  7, 0) \
+    _(0x1f, slo,     ABSOLUTE_X,  7, 0) \
+    _(0x20, jsr,     ABSOLUTE,    6, 0) \
+    _(0x21, And,     INDIRECT_X,  6, 0) \
+    _(0x22, nop,     IMPLIED,     2, 0) \
+    _(0x23, rla,     INDIRECT_X,  8, 0) \
+    _(0x24, Bit,     ZEROPAGE,    3, 0) \
+    _(0x25, And,     ZEROPAGE,    3, 0) \
+    _(0x26, rol,     ZEROPAGE,    5, 0) \
+    _(0x27, rla,     ZEROPAGE,    5, 0) \
+    _(0x28, plp,     IMPLIED,     4, 0) \
+    _(0x29, And,     IMMEDIATE,   2, 0) \
+    _(0x2a, rol_a,   ACCUMULATOR, 2, 0) \
+    _(0x2b, nop,     IMMEDIATE,   2, 0) \
+    _(0x2c, Bit,     ABSOLUTE,    4, 0) \
+    _(0x2d, And,     ABSOLUTE,    4, 0) \
+    _(0x2e, rol,     ABSOLUTE,    6, 0) \
+    _(0x2f, rla,     ABSOLUTE,    6, 0) \
+    _(0x30, bmi,     RELATIVE,    2, 0) \
+    _(0x31, And,     INDIRECT_Y,  5, 1) \
+    _(0x32, nop,     IMPLIED,     2, 0) \
+    _(0x33, rla,     INDIRECT_Y,  8, 0) \
+    _(0x34, nop,     ZEROPAGE_X,  4, 0) \
+    _(0x35, And,     ZEROPAGE_X,  4, 0) \
+    _(0x36, rol,     ZEROPAGE_X,  6, 0) \
+    _(0x37, rla,     ZEROPAGE_X,  6, 0) \
+    _(0x38, sec,     IMPLIED,     2, 0) \
+    _(0x39, And,     ABSOLUTE_Y,  4, 1) \
+    _(0x3a, nop,     IMPLIED,     2, 0) \
+    _(0x3b, rla,     ABSOLUTE_Y,  7, 0) \
+    _(0x3c, noP,     ABSOLUTE_X,  4, 1) \
+    _(0x3d, And,     ABSOLUTE_X,  4, 1) \
+    _(0x3e, rol,     ABSOLUTE_X,  7, 0) \
+    _(0x3f, rla,     ABSOLUTE_X,  7, 0) \
+    _(0x40, rti,     IMPLIED,     6, 0) \
+    _(0x41, eor,     INDIRECT_X,  6, 0) \
+    _(0x42, nop,     IMPLIED,     2, 0) \
+    _(0x43, sre,     INDIRECT_X,  8, 0) \
+    _(0x44, nop,     ZEROPAGE,    3, 0) \
+    _(0x45, eor,     ZEROPAGE,    3, 0) \
+    _(0x46, lsr,     ZEROPAGE,    5, 0) \
+    _(0x47, sre,     ZEROPAGE,    5, 0) \
+    _(0x48, pha,     IMPLIED,     3, 0) \
+    _(0x49, eor,     IMMEDIATE,   2, 0) \
+    _(0x4a, lsr_a,   ACCUMULATOR, 2, 0) \
+    _(0x4b, nop,     IMMEDIATE,   2, 0) \
+    _(0x4c, jmp,     ABSOLUTE,    3, 0) \
+    _(0x4d, eor,     ABSOLUTE,    4, 0) \
+    _(0x4e, lsr,     ABSOLUTE,    6, 0) \
+    _(0x4f, sre,     ABSOLUTE,    6, 0) \
+    _(0x50, bvc,     RELATIVE,    2, 0) \
+    _(0x51, eor,     INDIRECT_Y,  5, 1) \
+    _(0x52, nop,     IMPLIED,     2, 0) \
+    _(0x53, sre,     INDIRECT_Y,  8, 0) \
+    _(0x54, nop,     ZEROPAGE_X,  4, 0) \
+    _(0x55, eor,     ZEROPAGE_X,  4, 0) \
+    _(0x56, lsr,     ZEROPAGE_X,  6, 0) \
+    _(0x57, sre,     ZEROPAGE_X,  6, 0) \
+    _(0x58, cli6502, IMPLIED,     2, 0) \
+    _(0x59, eor,     ABSOLUTE_Y,  4, 1) \
+    _(0x5a, nop,     IMPLIED,     2, 0) \
+    _(0x5b, sre,     ABSOLUTE_Y,  7, 0) \
+    _(0x5c, noP,     ABSOLUTE_X,  4, 1) \
+    _(0x5d, eor,     ABSOLUTE_X,  4, 1) \
+    _(0x5e, lsr,     ABSOLUTE_X,  7, 0) \
+    _(0x5f, sre,     ABSOLUTE_X,  7, 0) \
+    _(0x60, rts,     IMPLIED,     6, 0) \
+    _(0x61, adc,     INDIRECT_X,  6, 0) \
+    _(0x62, nop,     IMPLIED,     2, 0) \
+    _(0x63, rra,     INDIRECT_X,  8, 0) \
+    _(0x64, nop,     ZEROPAGE,    3, 0) \
+    _(0x65, adc,     ZEROPAGE,    3, 0) \
+    _(0x66, ror,     ZEROPAGE,    5, 0) \
+    _(0x67, rra,     ZEROPAGE,    5, 0) \
+    _(0x68, pla,     IMPLIED,     4, 0) \
+    _(0x69, adc,     IMMEDIATE,   2, 0) \
+    _(0x6a, ror_a,   ACCUMULATOR, 2, 0) \
+    _(0x6b, nop,     IMMEDIATE,   2, 0) \
+    _(0x6c, jmp,     INDIRECT,    5, 0) \
+    _(0x6d, adc,     ABSOLUTE,    4, 0) \
+    _(0x6e, ror,     ABSOLUTE,    6, 0) \
+    _(0x6f, rra,     ABSOLUTE,    6, 0) \
+    _(0x70, bvs,     RELATIVE,    2, 0) \
+    _(0x71, adc,     INDIRECT_Y,  5, 1) \
+    _(0x72, nop,     IMPLIED,     2, 0) \
+    _(0x73, rra,     INDIRECT_Y,  8, 0) \
+    _(0x74, nop,     ZEROPAGE_X,  4, 0) \
+    _(0x75, adc,     ZEROPAGE_X,  4, 0) \
+    _(0x76, ror,     ZEROPAGE_X,  6, 0) \
+    _(0x77, rra,     ZEROPAGE_X,  6, 0) \
+    _(0x78, sei6502, IMPLIED,     2, 0) \
+    _(0x79, adc,     ABSOLUTE_Y,  4, 1) \
+    _(0x7a, nop,     IMPLIED,     2, 0) \
+    _(0x7b, rra,     ABSOLUTE_Y,  7, 0) \
+    _(0x7c, noP,     ABSOLUTE_X,  4, 1) \
+    _(0x7d, adc,     ABSOLUTE_X,  4, 1) \
+    _(0x7e, ror,     ABSOLUTE_X,  7, 0) \
+    _(0x7f, rra,     ABSOLUTE_X,  7, 0) \
+    _(0x80, nop,     IMMEDIATE,   2, 0) \
+    _(0x81, sta,     INDIRECT_X,  6, 0) \
+    _(0x82, nop,     IMMEDIATE,   2, 0) \
+    _(0x83, sax,     INDIRECT_X,  6, 0) \
+    _(0x84, sty,     ZEROPAGE,    3, 0) \
+    _(0x85, sta,     ZEROPAGE,    3, 0) \
+    _(0x86, stx,     ZEROPAGE,    3, 0) \
+    _(0x87, sax,     ZEROPAGE,    3, 0) \
+    _(0x88, dey,     IMPLIED,     2, 0) \
+    _(0x89, nop,     IMMEDIATE,   2, 0) \
+    _(0x8a, txa,     IMPLIED,     2, 0) \
+    _(0x8b, nop,     IMMEDIATE,   2, 0) \
+    _(0x8c, sty,     ABSOLUTE,    4, 0) \
+    _(0x8d, sta,     ABSOLUTE,    4, 0) \
+    _(0x8e, stx,     ABSOLUTE,    4, 0) \
+    _(0x8f, sax,     ABSOLUTE,    4, 0) \
+    _(0x90, bcc,     RELATIVE,    2, 0) \
+    _(0x91, sta,     INDIRECT_Y,  6, 0) \
+    _(0x92, nop,     IMPLIED,     2, 0) \
+    _(0x93, nop,     INDIRECT_Y,  6, 0) \
+    _(0x94, sty,     ZEROPAGE_X,  4, 0) \
+    _(0x95, sta,     ZEROPAGE_X,  4, 0) \
+    _(0x96, stx,     ZEROPAGE_Y,  4, 0) \
+    _(0x97, sax,     ZEROPAGE_Y,  4, 0) \
+    _(0x98, tya,     IMPLIED,     2, 0) \
+    _(0x99, sta,     ABSOLUTE_Y,  5, 0) \
+    _(0x9a, txs,     IMPLIED,     2, 0) \
+    _(0x9b, nop,     ABSOLUTE_Y,  5, 0) \
+    _(0x9c, noP,     ABSOLUTE_X,  5, 0) \
+    _(0x9d, sta,     ABSOLUTE_X,  5, 0) \
+    _(0x9e, nop,     ABSOLUTE_Y,  5, 0) \
+    _(0x9f, nop,     ABSOLUTE_Y,  5, 0) \
+    _(0xa0, ldy,     IMMEDIATE,   2, 0) \
+    _(0xa1, lda,     INDIRECT_X,  6, 0) \
+    _(0xa2, ldx,     IMMEDIATE,   2, 0) \
+    _(0xa3, lax,     INDIRECT_X,  6, 0) \
+    _(0xa4, ldy,     ZEROPAGE,    3, 0) \
+    _(0xa5, lda,     ZEROPAGE,    3, 0) \
+    _(0xa6, ldx,     ZEROPAGE,    3, 0) \
+    _(0xa7, lax,     ZEROPAGE,    3, 0) \
+    _(0xa8, tay,     IMPLIED,     2, 0) \
+    _(0xa9, lda,     IMMEDIATE,   2, 0) \
+    _(0xaa, tax,     IMPLIED,     2, 0) \
+    _(0xab, nop,     IMMEDIATE,   2, 0) \
+    _(0xac, ldy,     ABSOLUTE,    4, 0) \
+    _(0xad, lda,     ABSOLUTE,    4, 0) \
+    _(0xae, ldx,     ABSOLUTE,    4, 0) \
+    _(0xaf, lax,     ABSOLUTE,    4, 0) \
+    _(0xb0, bcs,     RELATIVE,    2, 0) \
+    _(0xb1, lda,     INDIRECT_Y,  5, 1) \
+    _(0xb2, nop,     IMPLIED,     2, 0) \
+    _(0xb3, lax,     INDIRECT_Y,  5, 1) \
+    _(0xb4, ldy,     ZEROPAGE_X,  4, 0) \
+    _(0xb5, lda,     ZEROPAGE_X,  4, 0) \
+    _(0xb6, ldx,     ZEROPAGE_Y,  4, 0) \
+    _(0xb7, lax,     ZEROPAGE_Y,  4, 0) \
+    _(0xb8, clv,     IMPLIED,     2, 0) \
+    _(0xb9, lda,     ABSOLUTE_Y,  4, 1) \
+    _(0xba, tsx,     IMPLIED,     2, 0) \
+    _(0xbb, lax,     ABSOLUTE_Y,  4, 1) \
+    _(0xbc, ldy,     ABSOLUTE_X,  4, 1) \
+    _(0xbd, lda,     ABSOLUTE_X,  4, 1) \
+    _(0xbe, ldx,     ABSOLUTE_Y,  4, 1) \
+    _(0xbf, lax,     ABSOLUTE_Y,  4, 1) \
+    _(0xc0, cpy,     IMMEDIATE,   2, 0) \
+    _(0xc1, cmp,     INDIRECT_X,  6, 0) \
+    _(0xc2, nop,     IMMEDIATE,   2, 0) \
+    _(0xc3, dcp,     INDIRECT_X,  8, 0) \
+    _(0xc4, cpy,     ZEROPAGE,    3, 0) \
+    _(0xc5, cmp,     ZEROPAGE,    3, 0) \
+    _(0xc6, dec,     ZEROPAGE,    5, 0) \
+    _(0xc7, dcp,     ZEROPAGE,    5, 0) \
+    _(0xc8, iny,     IMPLIED,     2, 0) \
+    _(0xc9, cmp,     IMMEDIATE,   2, 0) \
+    _(0xca, dex,     IMPLIED,     2, 0) \
+    _(0xcb, nop,     IMMEDIATE,   2, 0) \
+    _(0xcc, cpy,     ABSOLUTE,    4, 0) \
+    _(0xcd, cmp,     ABSOLUTE,    4, 0) \
+    _(0xce, dec,     ABSOLUTE,    6, 0) \
+    _(0xcf, dcp,     ABSOLUTE,    6, 0) \
+    _(0xd0, bne,     RELATIVE,    2, 0) \
+    _(0xd1, cmp,     INDIRECT_Y,  5, 1) \
+    _(0xd2, nop,     IMPLIED,     2, 0) \
+    _(0xd3, dcp,     INDIRECT_Y,  8, 0) \
+    _(0xd4, nop,     ZEROPAGE_X,  4, 0) \
+    _(0xd5, cmp,     ZEROPAGE_X,  4, 0) \
+    _(0xd6, dec,     ZEROPAGE_X,  6, 0) \
+    _(0xd7, dcp,     ZEROPAGE_X,  6, 0) \
+    _(0xd8, cld,     IMPLIED,     2, 0) \
+    _(0xd9, cmp,     ABSOLUTE_Y,  4, 1) \
+    _(0xda, nop,     IMPLIED,     2, 0) \
+    _(0xdb, dcp,     ABSOLUTE_Y,  7, 0) \
+    _(0xdc, noP,     ABSOLUTE_X,  4, 1) \
+    _(0xdd, cmp,     ABSOLUTE_X,  4, 1) \
+    _(0xde, dec,     ABSOLUTE_X,  7, 0) \
+    _(0xdf, dcp,     ABSOLUTE_X,  7, 0) \
+    _(0xe0, cpx,     IMMEDIATE,   2, 0) \
+    _(0xe1, sbc,     INDIRECT_X,  6, 0) \
+    _(0xe2, nop,     IMMEDIATE,   2, 0) \
+    _(0xe3, isb,     INDIRECT_X,  8, 0) \
+    _(0xe4, cpx,     ZEROPAGE,    3, 0) \
+    _(0xe5, sbc,     ZEROPAGE,    3, 0) \
+    _(0xe6, inc,     ZEROPAGE,    5, 0) \
+    _(0xe7, isb,     ZEROPAGE,    5, 0) \
+    _(0xe8, inx,     IMPLIED,     2, 0) \
+    _(0xe9, sbc,     IMMEDIATE,   2, 0) \
+    _(0xea, nop,     IMPLIED,     2, 0) \
+    _(0xeb, sbc,     IMMEDIATE,   2, 0) \
+    _(0xec, cpx,     ABSOLUTE,    4, 0) \
+    _(0xed, sbc,     ABSOLUTE,    4, 0) \
+    _(0xee, inc,     ABSOLUTE,    6, 0) \
+    _(0xef, isb,     ABSOLUTE,    6, 0) \
+    _(0xf0, beq,     RELATIVE,    2, 0) \
+    _(0xf1, sbc,     INDIRECT_Y,  5, 1) \
+    _(0xf2, nop,     IMPLIED,     2, 0) \
+    _(0xf3, isb,     INDIRECT_Y,  8, 0) \
+    _(0xf4, nop,     ZEROPAGE_X,  4, 0) \
+    _(0xf5, sbc,     ZEROPAGE_X,  4, 0) \
+    _(0xf6, inc,     ZEROPAGE_X,  6, 0) \
+    _(0xf7, isb,     ZEROPAGE_X,  6, 0) \
+    _(0xf8, sed,     IMPLIED,     2, 0) \
+    _(0xf9, sbc,     ABSOLUTE_Y,  4, 1) \
+    _(0xfa, nop,     IMPLIED,     2, 0) \
+    _(0xfb, isb,     ABSOLUTE_Y,  7, 0) \
+    _(0xfc, noP,     ABSOLUTE_X,  4, 1) \
+    _(0xfd, sbc,     ABSOLUTE_X,  4, 1) \
+    _(0xfe, inc,     ABSOLUTE_X,  7, 0) \
+    _(0xff, isb,     ABSOLUTE_X,  7, 0)
 
-struct patch_t {
-    uint16_t ea;
-    void (*func)(const char* name);
-    const char* name;
-};
- struct patch_t patches[32];
- int npatches=0;
+// begin kernal patcher
 
-inline int patch_cmp (const void * _a, const void * _b) {
-    struct patch_t* a = (struct patch_t*)_a;
-    struct patch_t* b = (struct patch_t*)_b;
-   return a->ea - b->ea;
+static bool patch_less(const MC6502::Patch& p, uint16_t ea)
+{
+    return p.ea < ea;
 }
+
 void MC6502::enable_patches(int on)
 {
+    patching = on;
+    memset(patched, 0, sizeof(patched));
+    if (!patching) return;
+    for (const Patch& p : patches) patched[p.ea>>3] |= 1<<(p.ea&7);
 }
+
 void MC6502::setpatch(uint16_t ea, void (*func)(const char* name),const char* name)
 {
-    patches[npatches].ea = ea;
-    patches[npatches].func = func;
-    patches[npatches].name = name;
-    npatches++;
-    qsort(patches, npatches, sizeof(patches[0]), patch_cmp);
+    std::vector<Patch>::iterator it = std::lower_bound(patches.begin(), patches.end(), ea, patch_less);
+    if (it==patches.end() || it->ea!=ea) it = patches.insert(it, Patch());
+    it->ea = ea;
+    it->func = func;
+    it->name = name;
+    if (patching) patched[ea>>3] |= 1<<(ea&7);
+}
+
+void MC6502::removepatch(uint16_t ea)
+{
+    std::vector<Patch>::iterator it = std::lower_bound(patches.begin(), patches.end(), ea, patch_less);
+    if (it==patches.end() || it->ea!=ea) return;
+    patches.erase(it);
+    patched[ea>>3] &= ~(1<<(ea&7));
 }
 
-patch_t* patch_lookup(uint16_t _pc)
+void MC6502::trap()
 {
-    if(npatches > 0)
+    for (;;)
     {
-        int low = 0;
-        int high = npatches - 1;
-        while(low < high)
-        {
-            int mid = low + (high-low)/2;
-            if(patches[mid].ea < _pc)
-                low = mid + 1;
-            else
-                high = mid;
-        }
-        if(patches[low].ea == _pc)
-            return patches+low;
+        uint16_t from = pc;
+        std::vector<Patch>::iterator it = std::lower_bound(patches.begin(), patches.end(), pc, patch_less);
+        if (it==patches.end() || it->ea!=pc) return;
+        it->func(it->name);
+        // a patch that returns to another patched address traps again
+        if (pc==from || !ispatched(pc)) return;
     }
-    return nullptr;
 }
 
+// end kernal patcher
+
 void MC6502::jmp() {
     pc = ea;
-
-    patch_t* p = patch_lookup(ea);
-    if (p) p->func(p->name);
 }
 
-// end kernal patcher
-
 void MC6502::jsr() {
     push16(pc - 1);
     pc = ea;
-    patch_t* p = patch_lookup(ea);
-    if (p) p->func(p->name);
 }
 
 void MC6502::nmi()
 {
+    idle.dirty = true;
     push16(pc);
     status |= FLAG_CONSTANT;
-    push8(status);
+    push8(flags());
     status |= FLAG_INTERRUPT;
     pc = (uint16_t)peek(0xFFFA) | ((uint16_t)peek(0xFFFB) << 8);
 }
@@ -89,76 +346,165 @@ void MC6502::irq()
 {
     status |= FLAG_CONSTANT;
     if (status & FLAG_INTERRUPT) return;
+    idle.dirty = true;
     push16(pc);
-    push8(status);
+    push8(flags());
     status |= FLAG_INTERRUPT;
     pc = (uint16_t)peek(0xFFFE) | ((uint16_t)peek(0xFFFF) << 8);
 }
 
+void MC6502::interrupt()
+{
+    if (nmiedge)
+    {
+        nmiedge = false;
+        nmi();
+    }
+    else if (irqline && !(status & FLAG_INTERRUPT))
+    {
+        irq();
+    }
+}
+
 void MC6502::init()
 {
+    breakpoints.clear();
+    for (int i=0; i<3; ++i)
+    {
+        if (breakmap[i]) memset(breakmap[i], 0, 0x10000/8);
+    }
     n_breakpoints = 0;
+    n_watchpoints = 0;
+    direct = 0x200;
+    irqline = 0;
+    nmiline = 0;
+    nmiedge = false;
     cyclehack = 0;
+    stopped = nullptr;
+    idle.dirty = true;
+    idlecycles = 0;
+    enable_patches(1);
+    for (int i=0; i<16; ++i) code[i] = nullptr;
+#if defined(CPU_BLOCK_CACHE)
+    blocks.flush();
+#endif
+}
+
+static int breakkind(uint8_t flags)
+{
+    if (flags & Breakpoint::READ) return MC6502::BREAK_READ;
+    if (flags & Breakpoint::WRITE) return MC6502::BREAK_WRITE;
+    return MC6502::BREAK_EXEC;
 }
 
 void MC6502::addBreakpoint(uint16_t _pc, uint8_t _flags, uint8_t _a, uint8_t _x, uint8_t _y)
 {
-    if (n_breakpoints>=BREAKPOINT_COUNT) return;
-    Breakpoint* bp = breakpoints+n_breakpoints;
-    n_breakpoints++;
+    int kind = breakkind(_flags);
+    int first = kind, last = kind;
+    if (kind!=BREAK_EXEC)
+    {
+        // watched() tests either watch map as soon as one watchpoint is armed
+        first = BREAK_READ;
+        last = BREAK_WRITE;
+    }
+    for (int i=first; i<=last; ++i)
+    {
+        if (breakmap[i]==nullptr) breakmap[i] = (uint8_t*)calloc(0x10000/8, 1);
+        if (breakmap[i]==nullptr) return;
+    }
+    Breakpoint* bp = findBreakpoint(_pc, _flags);
+    if (bp==nullptr)
+    {
+        breakpoints.push_back(Breakpoint());
+        bp = &breakpoints.back();
+    }
+    else if (marked(kind, _pc))
+    {
+        if (kind==BREAK_EXEC) n_breakpoints--; else n_watchpoints--;
+    }
     bp->pc = _pc;
     bp->a = _a;
     bp->x = _x;
     bp->y = _y;
     bp->flags = _flags;
+    bp->hits = 0;
+    bp->condition = Condition();
+    if (_flags & Breakpoint::ENABLE)
+    {
+        breakmap[kind][_pc>>3] |= 1<<(_pc&7);
+        if (kind==BREAK_EXEC) n_breakpoints++; else n_watchpoints++;
+    }
+    else
+    {
+        breakmap[kind][_pc>>3] &= ~(1<<(_pc&7));
+    }
+    direct = n_watchpoints ? 0 : 0x200; // watchpoints see every access
 }
 
-Breakpoint* MC6502::hitsBreakpoint()
+void MC6502::addBreakpoint(uint16_t _pc, const Condition& _condition, uint8_t _flags)
 {
-    Breakpoint* bp = nullptr;
-    if (n_breakpoints==0) return bp;
-    for (int i=0; i<n_breakpoints; ++i)
+    if (_condition.empty())
     {
-        if (breakpoints[i].pc!=pc) continue;
-        bp = breakpoints+i;
+        addBreakpoint(_pc, _flags);
+        return;
     }
-    if (bp==nullptr) return nullptr;
+    addBreakpoint(_pc, _flags | Breakpoint::EXPRESSION);
+    Breakpoint* bp = findBreakpoint(_pc, _flags);
+    if (bp) bp->condition = _condition;
+}
 
-    if (bp->flags & Breakpoint::ENABLE)
-    {
-        if ((bp->flags & Breakpoint::CONDITION_A) && bp->a != cpu.a) return nullptr;
-        if ((bp->flags & Breakpoint::CONDITION_X) && bp->x != cpu.x) return nullptr;
-        if ((bp->flags & Breakpoint::CONDITION_Y) && bp->y != cpu.y) return nullptr;
+// conditions of a breakpoint whose bit is set
+Breakpoint* MC6502::triggered(Breakpoint* bp)
+{
+    if (bp==nullptr || !(bp->flags & Breakpoint::ENABLE)) return nullptr;
+    bp->hits++;
+    if ((bp->flags & Breakpoint::CONDITION_A) && bp->a != a) return nullptr;
+    if ((bp->flags & Breakpoint::CONDITION_X) && bp->x != x) return nullptr;
+    if ((bp->flags & Breakpoint::CONDITION_Y) && bp->y != y) return nullptr;
+    if ((bp->flags & Breakpoint::EXPRESSION) && !bp->condition.eval(*this, bp->hits)) return nullptr;
 
-        if (onHit) onHit(bp);
+    if (onHit) onHit(bp);
 
-        return bp;
-    }
-    return nullptr;
+    return bp;
 }
 
-Breakpoint* MC6502::findBreakpoint(uint16_t _pc)
+Breakpoint* MC6502::hitsBreakpoint()
+{
+    if (n_breakpoints==0 || !marked(BREAK_EXEC, pc)) return nullptr;
+    return triggered(findBreakpoint(pc));
+}
+
+Breakpoint* MC6502::watch(int kind, uint16_t address)
 {
-    for (int i=0; i<n_breakpoints; ++i)
+    if (paused) return nullptr; // the monitor itself is looking, stepIn() and stepOut() lift this
+    Breakpoint* bp = triggered(findBreakpoint(address, kind==BREAK_READ ? Breakpoint::READ : Breakpoint::WRITE));
+    if (bp) stopped = bp;
+    return bp;
+}
+
+Breakpoint* MC6502::findBreakpoint(uint16_t _pc, uint8_t _flags)
+{
+    int kind = breakkind(_flags);
+    for (size_t i=0; i<breakpoints.size(); ++i)
     {
-        if (breakpoints[i].pc==_pc) return breakpoints+i;
+        if (breakpoints[i].pc==_pc && breakkind(breakpoints[i].flags)==kind) return &breakpoints[i];
     }
     return nullptr;
 }
 
-void MC6502::removeBreakpoint(uint16_t _pc)
+void MC6502::removeBreakpoint(uint16_t _pc, uint8_t _flags)
 {
-    int i=0;
-    for (;i<n_breakpoints; ++i)
+    Breakpoint* bp = findBreakpoint(_pc, _flags);
+    if (bp==nullptr) return;
+    int kind = breakkind(_flags);
+    if (marked(kind, _pc))
     {
-        if (breakpoints[i].pc!=_pc) continue;
-        n_breakpoints--;
-        if (i != n_breakpoints)
-        {
-            breakpoints[i] = breakpoints[n_breakpoints];
-        }
-        return;
+        breakmap[kind][_pc>>3] &= ~(1<<(_pc&7));
+        if (kind==BREAK_EXEC) n_breakpoints--; else n_watchpoints--;
     }
+    direct = n_watchpoints ? 0 : 0x200;
+    *bp = breakpoints.back();
+    breakpoints.pop_back();
 }
 
 void MC6502::reset()
@@ -171,3392 +517,304 @@ void MC6502::reset()
     y = 0;
     sp = 0xFD;
     cycles = 0;
-    status = FLAG_CONSTANT;
+    setflags(FLAG_CONSTANT);
     paused = 0;
     cyclehack = 0;
+#if defined(CPU_BLOCK_CACHE)
+    blocks.flush();
+#endif
+}
+
+#define OPCODE_HANDLER(_opcode,_operation,_mode,_cycles,_penalty) &MC6502::execute<MC6502::_mode,_cycles,_penalty,&MC6502::_operation,CYCLED>,
+template <bool CYCLED>
+struct OpcodeHandlers
+{
+    static constexpr MC6502::handler_t table[256] = { CPU_OPCODES(OPCODE_HANDLER) };
+};
+template <bool CYCLED> constexpr MC6502::handler_t OpcodeHandlers<CYCLED>::table[256];
+const MC6502::handler_t* const MC6502::handlers[2] = { OpcodeHandlers<false>::table, OpcodeHandlers<true>::table };
+
+#define OPCODE_INFO(_opcode,_operation,_mode,_cycles,_penalty) { MC6502::_mode, _cycles, _penalty },
+const MC6502::Opcode MC6502::opcodes[256] = { CPU_OPCODES(OPCODE_INFO) };
+
+// instruction length including the opcode
+static uint8_t length(uint8_t opcode)
+{
+    switch (MC6502::opcodes[opcode].mode)
+    {
+        case MC6502::IMPLIED:
+        case MC6502::ACCUMULATOR:
+            return 1;
+        case MC6502::ABSOLUTE:
+        case MC6502::ABSOLUTE_X:
+        case MC6502::ABSOLUTE_Y:
+        case MC6502::INDIRECT:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+// operand as fetch() returns it
+static uint16_t operand(uint8_t opcode, uint16_t address, uint8_t lo, uint8_t hi)
+{
+    if (MC6502::opcodes[opcode].mode==MC6502::IMMEDIATE) return address+1;
+    return lo | (hi << 8);
+}
+
+const MC6502::Decoded* MC6502::decode(const uint8_t* rom, uint16_t base, uint16_t size)
+{
+    Decoded* cache = (Decoded*)malloc(size*sizeof(Decoded));
+    if (cache==nullptr) return nullptr;
+    for (uint32_t i=0; i<size; ++i)
+    {
+        Decoded& d = cache[i];
+        d.opcode = rom[i];
+        d.length = length(d.opcode);
+        if (i+d.length>size)
+        {
+            d.length = 0;
+            d.operand = 0;
+            continue;
+        }
+        d.operand = operand(d.opcode, base+i, d.length>1 ? rom[i+1] : 0, d.length>2 ? rom[i+2] : 0);
+    }
+    return cache - base;
+}
+
+#if defined(CPU_BLOCK_CACHE)
+
+void MC6502::BlockCache::flush()
+{
+    for (int i=0; i<256; ++i)
+    {
+        page[i] = nullptr;
+        if (writes[i]!=EXCLUDED) writes[i] = 0;
+    }
+    for (int i=0; i<BUFFERS; ++i) owner[i] = -1;
+    exclude(0x00,0x01); // zeropage and stack are data
+}
+
+void MC6502::BlockCache::exclude(uint8_t first, uint8_t last)
+{
+    for (int i=first; i<=last; ++i)
+    {
+        drop(i);
+        writes[i] = EXCLUDED;
+    }
+}
+
+void MC6502::BlockCache::drop(uint8_t p)
+{
+    if (page[p]==nullptr) return;
+    page[p] = nullptr;
+    for (int i=0; i<BUFFERS; ++i)
+    {
+        if (owner[i]==p) owner[i] = -1;
+    }
+}
+
+// bulk writes to RAM that do not go through poke()
+void MC6502::BlockCache::invalidate(uint16_t address, uint32_t size)
+{
+    if (size==0) return;
+    uint32_t last = (address+size-1) >> 8;
+    for (uint32_t p=address>>8; p<=last && p<256; ++p) drop(p);
+}
+
+// a write to a cached page, drops the instructions the byte belongs to
+void MC6502::BlockCache::write(uint16_t address)
+{
+    Decoded* d = page[address>>8];
+    uint8_t offset = address & 0xFF;
+    bool modified = false;
+    if (d[address].length) { d[address].length = 0; modified = true; }
+    if (offset>=1 && d[address-1].length>=2) { d[address-1].length = 0; modified = true; }
+    if (offset>=2 && d[address-2].length==3) { d[address-2].length = 0; modified = true; }
+    if (!modified) return;
+    if (++writes[address>>8]>=SMC_LIMIT) drop(address>>8);
+}
+
+// decode the straight-line run at pc into the page cache, nullptr when it can't be decoded.
+// The bytes come from the page tables: reading ahead through peek() would trip read watchpoints and
+// touch I/O for instructions that never run, a page without a table entry is not decoded at all
+const MC6502::Decoded* MC6502::translate()
+{
+    uint8_t p = pc>>8;
+    const uint8_t* mem = read_pages[p];
+    if (mem==nullptr)
+    {
+        blocks.misses++;
+        return nullptr;
+    }
+    Decoded* d = blocks.page[p];
+    if (d==nullptr)
+    {
+        int b = blocks.next;
+        blocks.next = (blocks.next+1) % BlockCache::BUFFERS;
+        if (blocks.buffer[b]==nullptr) blocks.buffer[b] = (Decoded*)malloc(256*sizeof(Decoded));
+        if (blocks.buffer[b]==nullptr)
+        {
+            blocks.misses++;
+            return nullptr;
+        }
+        if (blocks.owner[b]>=0) blocks.page[blocks.owner[b]] = nullptr;
+        blocks.owner[b] = p;
+        memset(blocks.buffer[b],0,256*sizeof(Decoded));
+        d = blocks.page[p] = blocks.buffer[b] - (p<<8);
+    }
+
+    for (uint16_t address=pc; d[address].length==0; )
+    {
+        uint8_t opcode = mem[address];
+        uint8_t n = length(opcode);
+        if ((address & 0xFF) + n > 0x100) break; // continues in the next page
+        Decoded& e = d[address];
+        e.opcode = opcode;
+        e.operand = operand(opcode, address, n>1 ? mem[address+1] : 0, n>2 ? mem[address+2] : 0);
+        e.length = n;
+        address += n;
+        // the block ends with a branch, jump, return or break
+        if (opcodes[opcode].mode==RELATIVE) break;
+        if (opcode==0x00 || opcode==0x20 || opcode==0x40 || opcode==0x4C || opcode==0x60 || opcode==0x6C) break;
+        if ((address & 0xFF)==0) break;
+    }
+
+    blocks.misses++;
+    return d[pc].length ? d+pc : nullptr;
+}
+
+#endif
+
+// dispatch, selectable at build time:
+// CPU_DISPATCH_GOTO   threaded code in fastrun(), every handler jumps straight to the next one through a table of labels (GCC, default)
+// CPU_DISPATCH_TABLE  call through the handlers[] member function tables
+// CPU_DISPATCH_SWITCH switch statement generated from CPU_OPCODES
+#if !defined(CPU_DISPATCH_GOTO) && !defined(CPU_DISPATCH_TABLE) && !defined(CPU_DISPATCH_SWITCH)
+#if defined(__GNUC__)
+#define CPU_DISPATCH_GOTO
+#else
+#define CPU_DISPATCH_TABLE
+#endif
+#endif
+
+#define OPCODE_LABEL(_opcode,_operation,_mode,_cycles,_penalty) &&op_##_opcode,
+#define OPCODE_DECODED_LABEL(_opcode,_operation,_mode,_cycles,_penalty) &&decoded_##_opcode,
+#if defined(CPU_BLOCK_CACHE)
+#define OPCODE_CACHED() true
+#else
+#define OPCODE_CACHED() code[pc>>12]
+#endif
+#define OPCODE_GOTO(_opcode,_operation,_mode,_cycles,_penalty) op_##_opcode: operand = fetch<_mode>(); \
+    decoded_##_opcode: execute<_mode,_cycles,_penalty,&MC6502::_operation,false>(operand); \
+    if (--count==0 || pc==until) return; \
+    if (OPCODE_CACHED() || ispatched(pc)) goto dispatch; \
+    opcode = peek(pc); pc++; \
+    goto *labels[opcode];
+#define OPCODE_CASE(_opcode,_operation,_mode,_cycles,_penalty) case _opcode: execute<_mode,_cycles,_penalty,&MC6502::_operation,CYCLED>(d); break;
+
+template <bool CYCLED>
+inline void MC6502::step()
+{
+    if (unlikely(ispatched(pc))) trap();
+    const Decoded* d = decoded();
+    if (d) { opcode = d->opcode; pc += d->length; }
+    else { opcode = peek(pc); pc++; }
+#if defined(CPU_DISPATCH_TABLE)
+    (this->*handlers[CYCLED][opcode])(d);
+#else
+    switch(opcode)
+    {
+        CPU_OPCODES(OPCODE_CASE)
+    }
+#endif
 }
 
 void MC6502::clock()
 {
     if (--cycles>cyclehack) return;
+    step<true>();
+}
+
+void MC6502::fastrun(uint32_t count, int32_t until)
+{
+    if (count==0) return;
+
+#if defined(CPU_DISPATCH_GOTO)
+    static void* const labels[256] = { CPU_OPCODES(OPCODE_LABEL) };
+    static void* const decoded_labels[256] = { CPU_OPCODES(OPCODE_DECODED_LABEL) };
+    uint16_t operand = 0;
+dispatch:
+    if (unlikely(ispatched(pc))) trap();
+    if (const Decoded* d = decoded())
+    {
+        opcode = d->opcode; pc += d->length; operand = d->operand;
+        goto *decoded_labels[opcode];
+    }
     opcode = peek(pc); pc++;
+    goto *labels[opcode];
+    CPU_OPCODES(OPCODE_GOTO)
+#else
+    for (;;)
+    {
+        step<false>();
+        if (--count==0 || pc==until) return;
+    }
+#endif
+}
 
-    switch(opcode)
+bool MC6502::idling()
+{
+    uint8_t f = flags();
+    if (!idle.dirty && idle.pc==pc && idle.sp==sp && idle.a==a && idle.x==x && idle.y==y && idle.status==f) return true;
+    idle.pc = pc;
+    idle.sp = sp;
+    idle.a = a;
+    idle.x = x;
+    idle.y = y;
+    idle.status = f;
+    idle.dirty = false;
+    return false;
+}
+
+int32_t MC6502::run(int32_t _budget)
+{
+    stopped = nullptr;
+    budget = _budget;
+    cut = 0;
+    if (n_breakpoints || n_watchpoints) return runloop<true>();
+    return runloop<false>();
+}
+
+template <bool DEBUG>
+int32_t MC6502::runloop()
+{
+    while (budget>0)
     {
-        case 0x0: // brk 
-        {
-            cycles=7;
-            brk();
-        }
-        break;
-        case 0x1: // ora (ea,x)
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            ora();
-        }
-        break;
-        case 0x2: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x3: // slo (ea,x)
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            slo();
-        }
-        break;
-        case 0x4: // nop (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            nop();
-        }
-        break;
-        case 0x5: // ora (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            ora();
-        }
-        break;
-        case 0x6: // asl (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            asl();
-        }
-        break;
-        case 0x7: // slo (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            slo();
-        }
-        break;
-        case 0x8: // php 
-        {
-            cycles=3;
-            php();
-        }
-        break;
-        case 0x9: // ora #imm
-        {
-            cycles=2;
-            ea = pc++;
-            ora();
-        }
-        break;
-        case 0xa: // asl_a a
-        {
-            cycles=2;
-            asl_a();
-        }
-        break;
-        case 0xb: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0xc: // nop ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            nop();
-        }
-        break;
-        case 0xd: // ora ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            ora();
-        }
-        break;
-        case 0xe: // asl ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            asl();
-        }
-        break;
-        case 0xf: // slo ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            slo();
-        }
-        break;
-        case 0x10: // bpl rea
-        {
-            cycles=2;
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bpl();
-        }
-        break;
-        case 0x11: // ora (ea),y
-        {
-            cycles=5;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            ora();
-        }
-        break;
-        case 0x12: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x13: // slo (ea),y
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            slo();
-        }
-        break;
-        case 0x14: // nop (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0x15: // ora (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            ora();
-        }
-        break;
-        case 0x16: // asl (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            asl();
-        }
-        break;
-        case 0x17: // slo (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            slo();
-        }
-        break;
-        case 0x18: // clc 
-        {
-            cycles=2;
-            clc();
-        }
-        break;
-        case 0x19: // ora ea,y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            ora();
-        }
-        break;
-        case 0x1a: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x1b: // slo ea,y
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            slo();
-        }
-        break;
-        case 0x1c: // noP ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0x1d: // ora ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            ora();
-        }
-        break;
-        case 0x1e: // asl ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            asl();
-        }
-        break;
-        case 0x1f: // slo ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            slo();
-        }
-        break;
-        case 0x20: // jsr ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            jsr();
-        }
-        break;
-        case 0x21: // and (ea,x)
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            And();
-        }
-        break;
-        case 0x22: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x23: // rla (ea,x)
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            rla();
-        }
-        break;
-        case 0x24: // bit (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            Bit();
-        }
-        break;
-        case 0x25: // and (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            And();
-        }
-        break;
-        case 0x26: // rol (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            rol();
-        }
-        break;
-        case 0x27: // rla (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            rla();
-        }
-        break;
-        case 0x28: // plp 
-        {
-            cycles=4;
-            plp();
-        }
-        break;
-        case 0x29: // and #imm
-        {
-            cycles=2;
-            ea = pc++;
-            And();
-        }
-        break;
-        case 0x2a: // rol_a a
-        {
-            cycles=2;
-            rol_a();
-        }
-        break;
-        case 0x2b: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x2c: // bit ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            Bit();
-        }
-        break;
-        case 0x2d: // and ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            And();
-        }
-        break;
-        case 0x2e: // rol ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            rol();
-        }
-        break;
-        case 0x2f: // rla ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            rla();
-        }
-        break;
-        case 0x30: // bmi rea
-        {
-            cycles=2;
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bmi();
-        }
-        break;
-        case 0x31: // and (ea),y
-        {
-            cycles=5;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            And();
-        }
-        break;
-        case 0x32: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x33: // rla (ea),y
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            rla();
-        }
-        break;
-        case 0x34: // nop (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0x35: // and (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            And();
-        }
-        break;
-        case 0x36: // rol (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            rol();
-        }
-        break;
-        case 0x37: // rla (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            rla();
-        }
-        break;
-        case 0x38: // sec 
-        {
-            cycles=2;
-            sec();
-        }
-        break;
-        case 0x39: // and ea,y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            And();
-        }
-        break;
-        case 0x3a: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x3b: // rla ea,y
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            rla();
-        }
-        break;
-        case 0x3c: // noP ea,x
+        uint32_t start = clockcycles;
+        uint16_t from = pc;
+        if (unlikely(irqline | nmiedge)) interrupt();
+        step<false>();
+        int32_t n = clockcycles-start;
+        budget -= (n>cyclehack) ? n-cyclehack : 1; // same as the countdown in clock()
+        if (DEBUG)
         {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
+            if (stopped==nullptr) stopped = hitsBreakpoint();
+            if (stopped) break;
         }
-        break;
-        case 0x3d: // and ea,x
+        if (unlikely((uint16_t)(from-pc)<=IDLE_LOOP_SIZE) && budget>0 && idling())
         {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            And();
+            // nothing but the next event can end the loop
+            clockcycles += budget;
+            idlecycles += budget;
+            budget = 0;
         }
-        break;
-        case 0x3e: // rol ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            rol();
-        }
-        break;
-        case 0x3f: // rla ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            rla();
-        }
-        break;
-        case 0x40: // rti 
-        {
-            cycles=6;
-            rti();
-        }
-        break;
-        case 0x41: // eor (ea,x)
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            eor();
-        }
-        break;
-        case 0x42: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x43: // sre (ea,x)
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            sre();
-        }
-        break;
-        case 0x44: // nop (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            nop();
-        }
-        break;
-        case 0x45: // eor (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            eor();
-        }
-        break;
-        case 0x46: // lsr (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            lsr();
-        }
-        break;
-        case 0x47: // sre (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            sre();
-        }
-        break;
-        case 0x48: // pha 
-        {
-            cycles=3;
-            pha();
-        }
-        break;
-        case 0x49: // eor #imm
-        {
-            cycles=2;
-            ea = pc++;
-            eor();
-        }
-        break;
-        case 0x4a: // lsr_a a
-        {
-            cycles=2;
-            lsr_a();
-        }
-        break;
-        case 0x4b: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x4c: // jmp ea
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            jmp();
-        }
-        break;
-        case 0x4d: // eor ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            eor();
-        }
-        break;
-        case 0x4e: // lsr ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            lsr();
-        }
-        break;
-        case 0x4f: // sre ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            sre();
-        }
-        break;
-        case 0x50: // bvc rea
-        {
-            cycles=2;
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bvc();
-        }
-        break;
-        case 0x51: // eor (ea),y
-        {
-            cycles=5;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            eor();
-        }
-        break;
-        case 0x52: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x53: // sre (ea),y
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            sre();
-        }
-        break;
-        case 0x54: // nop (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0x55: // eor (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            eor();
-        }
-        break;
-        case 0x56: // lsr (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            lsr();
-        }
-        break;
-        case 0x57: // sre (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            sre();
-        }
-        break;
-        case 0x58: // cli 
-        {
-            cycles=2;
-            cli6502();
-        }
-        break;
-        case 0x59: // eor ea,y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            eor();
-        }
-        break;
-        case 0x5a: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x5b: // sre ea,y
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            sre();
-        }
-        break;
-        case 0x5c: // noP ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0x5d: // eor ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            eor();
-        }
-        break;
-        case 0x5e: // lsr ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            lsr();
-        }
-        break;
-        case 0x5f: // sre ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            sre();
-        }
-        break;
-        case 0x60: // rts 
-        {
-            cycles=6;
-            rts();
-        }
-        break;
-        case 0x61: // adc (ea,x)
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            adc();
-        }
-        break;
-        case 0x62: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x63: // rra (ea,x)
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            rra();
-        }
-        break;
-        case 0x64: // nop (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            nop();
-        }
-        break;
-        case 0x65: // adc (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            adc();
-        }
-        break;
-        case 0x66: // ror (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            ror();
-        }
-        break;
-        case 0x67: // rra (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            rra();
-        }
-        break;
-        case 0x68: // pla 
-        {
-            cycles=4;
-            pla();
-        }
-        break;
-        case 0x69: // adc #imm
-        {
-            cycles=2;
-            ea = pc++;
-            adc();
-        }
-        break;
-        case 0x6a: // ror_a a
-        {
-            cycles=2;
-            ror_a();
-        }
-        break;
-        case 0x6b: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x6c: // jmp (ea)
-        {
-            cycles=5;
-            uint16_t u = (uint16_t)peek(pc++) | (uint16_t)((uint16_t)peek(pc++) << 8);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0xFF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            jmp();
-        }
-        break;
-        case 0x6d: // adc ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            adc();
-        }
-        break;
-        case 0x6e: // ror ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            ror();
-        }
-        break;
-        case 0x6f: // rra ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            rra();
-        }
-        break;
-        case 0x70: // bvs rea
-        {
-            cycles=2;
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bvs();
-        }
-        break;
-        case 0x71: // adc (ea),y
-        {
-            cycles=5;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            adc();
-        }
-        break;
-        case 0x72: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x73: // rra (ea),y
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            rra();
-        }
-        break;
-        case 0x74: // nop (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0x75: // adc (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            adc();
-        }
-        break;
-        case 0x76: // ror (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            ror();
-        }
-        break;
-        case 0x77: // rra (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            rra();
-        }
-        break;
-        case 0x78: // sei 
-        {
-            cycles=2;
-            sei6502();
-        }
-        break;
-        case 0x79: // adc ea,y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            adc();
-        }
-        break;
-        case 0x7a: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x7b: // rra ea,y
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            rra();
-        }
-        break;
-        case 0x7c: // noP ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0x7d: // adc ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            adc();
-        }
-        break;
-        case 0x7e: // ror ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            ror();
-        }
-        break;
-        case 0x7f: // rra ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            rra();
-        }
-        break;
-        case 0x80: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x81: // sta (ea,x)
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            sta();
-        }
-        break;
-        case 0x82: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x83: // sax (ea,x)
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            sax();
-        }
-        break;
-        case 0x84: // sty (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            sty();
-        }
-        break;
-        case 0x85: // sta (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            sta();
-        }
-        break;
-        case 0x86: // stx (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            stx();
-        }
-        break;
-        case 0x87: // sax (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            sax();
-        }
-        break;
-        case 0x88: // dey 
-        {
-            cycles=2;
-            dey();
-        }
-        break;
-        case 0x89: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x8a: // txa 
-        {
-            cycles=2;
-            txa();
-        }
-        break;
-        case 0x8b: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x8c: // sty ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            sty();
-        }
-        break;
-        case 0x8d: // sta ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            sta();
-        }
-        break;
-        case 0x8e: // stx ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            stx();
-        }
-        break;
-        case 0x8f: // sax ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            sax();
-        }
-        break;
-        case 0x90: // bcc rea
-        {
-            cycles=2;
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bcc();
-        }
-        break;
-        case 0x91: // sta (ea),y
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            sta();
-        }
-        break;
-        case 0x92: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0x93: // nop (ea),y
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            nop();
-        }
-        break;
-        case 0x94: // sty (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            sty();
-        }
-        break;
-        case 0x95: // sta (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            sta();
-        }
-        break;
-        case 0x96: // stx (zp),y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            stx();
-        }
-        break;
-        case 0x97: // sax (zp),y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            sax();
-        }
-        break;
-        case 0x98: // tya 
-        {
-            cycles=2;
-            tya();
-        }
-        break;
-        case 0x99: // sta ea,y
-        {
-            cycles=5;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            sta();
-        }
-        break;
-        case 0x9a: // txs 
-        {
-            cycles=2;
-            txs();
-        }
-        break;
-        case 0x9b: // nop ea,y
-        {
-            cycles=5;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            nop();
-        }
-        break;
-        case 0x9c: // noP ea,x
-        {
-            cycles=5;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0x9d: // sta ea,x
-        {
-            cycles=5;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            sta();
-        }
-        break;
-        case 0x9e: // nop ea,y
-        {
-            cycles=5;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            nop();
-        }
-        break;
-        case 0x9f: // nop ea,y
-        {
-            cycles=5;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            nop();
-        }
-        break;
-        case 0xa0: // ldy #imm
-        {
-            cycles=2;
-            ea = pc++;
-            ldy();
-        }
-        break;
-        case 0xa1: // lda (ea,x)
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            lda();
-        }
-        break;
-        case 0xa2: // ldx #imm
-        {
-            cycles=2;
-            ea = pc++;
-            ldx();
-        }
-        break;
-        case 0xa3: // lax (ea,x)
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            lax();
-        }
-        break;
-        case 0xa4: // ldy (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            ldy();
-        }
-        break;
-        case 0xa5: // lda (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            lda();
-        }
-        break;
-        case 0xa6: // ldx (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            ldx();
-        }
-        break;
-        case 0xa7: // lax (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            lax();
-        }
-        break;
-        case 0xa8: // tay 
-        {
-            cycles=2;
-            tay();
-        }
-        break;
-        case 0xa9: // lda #imm
-        {
-            cycles=2;
-            ea = pc++;
-            lda();
-        }
-        break;
-        case 0xaa: // tax 
-        {
-            cycles=2;
-            tax();
-        }
-        break;
-        case 0xab: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0xac: // ldy ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            ldy();
-        }
-        break;
-        case 0xad: // lda ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            lda();
-        }
-        break;
-        case 0xae: // ldx ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            ldx();
-        }
-        break;
-        case 0xaf: // lax ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            lax();
-        }
-        break;
-        case 0xb0: // bcs rea
-        {
-            cycles=2;
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bcs();
-        }
-        break;
-        case 0xb1: // lda (ea),y
-        {
-            cycles=5;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            lda();
-        }
-        break;
-        case 0xb2: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0xb3: // lax (ea),y
-        {
-            cycles=5;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            lax();
-        }
-        break;
-        case 0xb4: // ldy (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            ldy();
-        }
-        break;
-        case 0xb5: // lda (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            lda();
-        }
-        break;
-        case 0xb6: // ldx (zp),y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            ldx();
-        }
-        break;
-        case 0xb7: // lax (zp),y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            lax();
-        }
-        break;
-        case 0xb8: // clv 
-        {
-            cycles=2;
-            clv();
-        }
-        break;
-        case 0xb9: // lda ea,y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            lda();
-        }
-        break;
-        case 0xba: // tsx 
-        {
-            cycles=2;
-            tsx();
-        }
-        break;
-        case 0xbb: // lax ea,y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            lax();
-        }
-        break;
-        case 0xbc: // ldy ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            ldy();
-        }
-        break;
-        case 0xbd: // lda ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            lda();
-        }
-        break;
-        case 0xbe: // ldx ea,y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            ldx();
-        }
-        break;
-        case 0xbf: // lax ea,y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            lax();
-        }
-        break;
-        case 0xc0: // cpy #imm
-        {
-            cycles=2;
-            ea = pc++;
-            cpy();
-        }
-        break;
-        case 0xc1: // cmp (ea,x)
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            cmp();
-        }
-        break;
-        case 0xc2: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0xc3: // dcp (ea,x)
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            dcp();
-        }
-        break;
-        case 0xc4: // cpy (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            cpy();
-        }
-        break;
-        case 0xc5: // cmp (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            cmp();
-        }
-        break;
-        case 0xc6: // dec (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            dec();
-        }
-        break;
-        case 0xc7: // dcp (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            dcp();
-        }
-        break;
-        case 0xc8: // iny 
-        {
-            cycles=2;
-            iny();
-        }
-        break;
-        case 0xc9: // cmp #imm
-        {
-            cycles=2;
-            ea = pc++;
-            cmp();
-        }
-        break;
-        case 0xca: // dex 
-        {
-            cycles=2;
-            dex();
-        }
-        break;
-        case 0xcb: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0xcc: // cpy ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            cpy();
-        }
-        break;
-        case 0xcd: // cmp ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            cmp();
-        }
-        break;
-        case 0xce: // dec ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            dec();
-        }
-        break;
-        case 0xcf: // dcp ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            dcp();
-        }
-        break;
-        case 0xd0: // bne rea
-        {
-            cycles=2;
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bne();
-        }
-        break;
-        case 0xd1: // cmp (ea),y
-        {
-            cycles=5;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            cmp();
-        }
-        break;
-        case 0xd2: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0xd3: // dcp (ea),y
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            dcp();
-        }
-        break;
-        case 0xd4: // nop (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0xd5: // cmp (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            cmp();
-        }
-        break;
-        case 0xd6: // dec (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            dec();
-        }
-        break;
-        case 0xd7: // dcp (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            dcp();
-        }
-        break;
-        case 0xd8: // cld 
-        {
-            cycles=2;
-            cld();
-        }
-        break;
-        case 0xd9: // cmp ea,y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            cmp();
-        }
-        break;
-        case 0xda: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0xdb: // dcp ea,y
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            dcp();
-        }
-        break;
-        case 0xdc: // noP ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0xdd: // cmp ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            cmp();
-        }
-        break;
-        case 0xde: // dec ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            dec();
-        }
-        break;
-        case 0xdf: // dcp ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            dcp();
-        }
-        break;
-        case 0xe0: // cpx #imm
-        {
-            cycles=2;
-            ea = pc++;
-            cpx();
-        }
-        break;
-        case 0xe1: // sbc (ea,x)
-        {
-            cycles=6;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            sbc();
-        }
-        break;
-        case 0xe2: // nop #imm
-        {
-            cycles=2;
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0xe3: // isb (ea,x)
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            isb();
-        }
-        break;
-        case 0xe4: // cpx (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            cpx();
-        }
-        break;
-        case 0xe5: // sbc (zp)
-        {
-            cycles=3;
-            ea = (uint16_t)peek(pc++);
-            sbc();
-        }
-        break;
-        case 0xe6: // inc (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            inc();
-        }
-        break;
-        case 0xe7: // isb (zp)
-        {
-            cycles=5;
-            ea = (uint16_t)peek(pc++);
-            isb();
-        }
-        break;
-        case 0xe8: // inx 
-        {
-            cycles=2;
-            inx();
-        }
-        break;
-        case 0xe9: // sbc #imm
-        {
-            cycles=2;
-            ea = pc++;
-            sbc();
-        }
-        break;
-        case 0xea: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0xeb: // sbc #imm
-        {
-            cycles=2;
-            ea = pc++;
-            sbc();
-        }
-        break;
-        case 0xec: // cpx ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            cpx();
-        }
-        break;
-        case 0xed: // sbc ea
-        {
-            cycles=4;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            sbc();
-        }
-        break;
-        case 0xee: // inc ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            inc();
-        }
-        break;
-        case 0xef: // isb ea
-        {
-            cycles=6;
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            isb();
-        }
-        break;
-        case 0xf0: // beq rea
-        {
-            cycles=2;
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            beq();
-        }
-        break;
-        case 0xf1: // sbc (ea),y
-        {
-            cycles=5;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            sbc();
-        }
-        break;
-        case 0xf2: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0xf3: // isb (ea),y
-        {
-            cycles=8;
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            isb();
-        }
-        break;
-        case 0xf4: // nop (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0xf5: // sbc (zp),x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            sbc();
-        }
-        break;
-        case 0xf6: // inc (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            inc();
-        }
-        break;
-        case 0xf7: // isb (zp),x
-        {
-            cycles=6;
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            isb();
-        }
-        break;
-        case 0xf8: // sed 
-        {
-            cycles=2;
-            sed();
-        }
-        break;
-        case 0xf9: // sbc ea,y
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            sbc();
-        }
-        break;
-        case 0xfa: // nop 
-        {
-            cycles=2;
-            nop();
-        }
-        break;
-        case 0xfb: // isb ea,y
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            isb();
-        }
-        break;
-        case 0xfc: // noP ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0xfd: // sbc ea,x
-        {
-            cycles=4;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            sbc();
-        }
-        break;
-        case 0xfe: // inc ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            inc();
-        }
-        break;
-        case 0xff: // isb ea,x
-        {
-            cycles=7;
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            isb();
-        }
-        break;
-    }
-}
-
-void MC6502::fastclock()
-{
-    opcode = peek(pc); pc++;
-
-    switch(opcode)
-    {
-        case 0x0: // brk 
-        {
-            brk();
-        }
-        break;
-        case 0x1: // ora (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            ora();
-        }
-        break;
-        case 0x2: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x3: // slo (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            slo();
-        }
-        break;
-        case 0x4: // nop (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            nop();
-        }
-        break;
-        case 0x5: // ora (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            ora();
-        }
-        break;
-        case 0x6: // asl (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            asl();
-        }
-        break;
-        case 0x7: // slo (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            slo();
-        }
-        break;
-        case 0x8: // php 
-        {
-            php();
-        }
-        break;
-        case 0x9: // ora #imm
-        {
-            ea = pc++;
-            ora();
-        }
-        break;
-        case 0xa: // asl_a a
-        {
-            asl_a();
-        }
-        break;
-        case 0xb: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0xc: // nop ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            nop();
-        }
-        break;
-        case 0xd: // ora ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            ora();
-        }
-        break;
-        case 0xe: // asl ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            asl();
-        }
-        break;
-        case 0xf: // slo ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            slo();
-        }
-        break;
-        case 0x10: // bpl rea
-        {
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bpl();
-        }
-        break;
-        case 0x11: // ora (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            ora();
-        }
-        break;
-        case 0x12: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x13: // slo (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            slo();
-        }
-        break;
-        case 0x14: // nop (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0x15: // ora (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            ora();
-        }
-        break;
-        case 0x16: // asl (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            asl();
-        }
-        break;
-        case 0x17: // slo (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            slo();
-        }
-        break;
-        case 0x18: // clc 
-        {
-            clc();
-        }
-        break;
-        case 0x19: // ora ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            ora();
-        }
-        break;
-        case 0x1a: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x1b: // slo ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            slo();
-        }
-        break;
-        case 0x1c: // noP ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0x1d: // ora ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            ora();
-        }
-        break;
-        case 0x1e: // asl ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            asl();
-        }
-        break;
-        case 0x1f: // slo ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            slo();
-        }
-        break;
-        case 0x20: // jsr ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            jsr();
-        }
-        break;
-        case 0x21: // and (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            And();
-        }
-        break;
-        case 0x22: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x23: // rla (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            rla();
-        }
-        break;
-        case 0x24: // bit (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            Bit();
-        }
-        break;
-        case 0x25: // and (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            And();
-        }
-        break;
-        case 0x26: // rol (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            rol();
-        }
-        break;
-        case 0x27: // rla (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            rla();
-        }
-        break;
-        case 0x28: // plp 
-        {
-            plp();
-        }
-        break;
-        case 0x29: // and #imm
-        {
-            ea = pc++;
-            And();
-        }
-        break;
-        case 0x2a: // rol_a a
-        {
-            rol_a();
-        }
-        break;
-        case 0x2b: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x2c: // bit ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            Bit();
-        }
-        break;
-        case 0x2d: // and ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            And();
-        }
-        break;
-        case 0x2e: // rol ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            rol();
-        }
-        break;
-        case 0x2f: // rla ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            rla();
-        }
-        break;
-        case 0x30: // bmi rea
-        {
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bmi();
-        }
-        break;
-        case 0x31: // and (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            And();
-        }
-        break;
-        case 0x32: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x33: // rla (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            rla();
-        }
-        break;
-        case 0x34: // nop (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0x35: // and (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            And();
-        }
-        break;
-        case 0x36: // rol (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            rol();
-        }
-        break;
-        case 0x37: // rla (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            rla();
-        }
-        break;
-        case 0x38: // sec 
-        {
-            sec();
-        }
-        break;
-        case 0x39: // and ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            And();
-        }
-        break;
-        case 0x3a: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x3b: // rla ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            rla();
-        }
-        break;
-        case 0x3c: // noP ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0x3d: // and ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            And();
-        }
-        break;
-        case 0x3e: // rol ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            rol();
-        }
-        break;
-        case 0x3f: // rla ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            rla();
-        }
-        break;
-        case 0x40: // rti 
-        {
-            rti();
-        }
-        break;
-        case 0x41: // eor (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            eor();
-        }
-        break;
-        case 0x42: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x43: // sre (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            sre();
-        }
-        break;
-        case 0x44: // nop (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            nop();
-        }
-        break;
-        case 0x45: // eor (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            eor();
-        }
-        break;
-        case 0x46: // lsr (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            lsr();
-        }
-        break;
-        case 0x47: // sre (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            sre();
-        }
-        break;
-        case 0x48: // pha 
-        {
-            pha();
-        }
-        break;
-        case 0x49: // eor #imm
-        {
-            ea = pc++;
-            eor();
-        }
-        break;
-        case 0x4a: // lsr_a a
-        {
-            lsr_a();
-        }
-        break;
-        case 0x4b: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x4c: // jmp ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            jmp();
-        }
-        break;
-        case 0x4d: // eor ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            eor();
-        }
-        break;
-        case 0x4e: // lsr ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            lsr();
-        }
-        break;
-        case 0x4f: // sre ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            sre();
-        }
-        break;
-        case 0x50: // bvc rea
-        {
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bvc();
-        }
-        break;
-        case 0x51: // eor (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            eor();
-        }
-        break;
-        case 0x52: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x53: // sre (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            sre();
-        }
-        break;
-        case 0x54: // nop (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0x55: // eor (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            eor();
-        }
-        break;
-        case 0x56: // lsr (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            lsr();
-        }
-        break;
-        case 0x57: // sre (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            sre();
-        }
-        break;
-        case 0x58: // cli 
-        {
-            cli6502();
-        }
-        break;
-        case 0x59: // eor ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            eor();
-        }
-        break;
-        case 0x5a: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x5b: // sre ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            sre();
-        }
-        break;
-        case 0x5c: // noP ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0x5d: // eor ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            eor();
-        }
-        break;
-        case 0x5e: // lsr ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            lsr();
-        }
-        break;
-        case 0x5f: // sre ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            sre();
-        }
-        break;
-        case 0x60: // rts 
-        {
-            rts();
-        }
-        break;
-        case 0x61: // adc (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            adc();
-        }
-        break;
-        case 0x62: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x63: // rra (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            rra();
-        }
-        break;
-        case 0x64: // nop (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            nop();
-        }
-        break;
-        case 0x65: // adc (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            adc();
-        }
-        break;
-        case 0x66: // ror (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            ror();
-        }
-        break;
-        case 0x67: // rra (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            rra();
-        }
-        break;
-        case 0x68: // pla 
-        {
-            pla();
-        }
-        break;
-        case 0x69: // adc #imm
-        {
-            ea = pc++;
-            adc();
-        }
-        break;
-        case 0x6a: // ror_a a
-        {
-            ror_a();
-        }
-        break;
-        case 0x6b: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x6c: // jmp (ea)
-        {
-            uint16_t u = (uint16_t)peek(pc++) | (uint16_t)((uint16_t)peek(pc++) << 8);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0xFF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            jmp();
-        }
-        break;
-        case 0x6d: // adc ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            adc();
-        }
-        break;
-        case 0x6e: // ror ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            ror();
-        }
-        break;
-        case 0x6f: // rra ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            rra();
-        }
-        break;
-        case 0x70: // bvs rea
-        {
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bvs();
-        }
-        break;
-        case 0x71: // adc (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            adc();
-        }
-        break;
-        case 0x72: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x73: // rra (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            rra();
-        }
-        break;
-        case 0x74: // nop (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0x75: // adc (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            adc();
-        }
-        break;
-        case 0x76: // ror (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            ror();
-        }
-        break;
-        case 0x77: // rra (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            rra();
-        }
-        break;
-        case 0x78: // sei 
-        {
-            sei6502();
-        }
-        break;
-        case 0x79: // adc ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            adc();
-        }
-        break;
-        case 0x7a: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x7b: // rra ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            rra();
-        }
-        break;
-        case 0x7c: // noP ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0x7d: // adc ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            adc();
-        }
-        break;
-        case 0x7e: // ror ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            ror();
-        }
-        break;
-        case 0x7f: // rra ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            rra();
-        }
-        break;
-        case 0x80: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x81: // sta (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            sta();
-        }
-        break;
-        case 0x82: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x83: // sax (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            sax();
-        }
-        break;
-        case 0x84: // sty (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            sty();
-        }
-        break;
-        case 0x85: // sta (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            sta();
-        }
-        break;
-        case 0x86: // stx (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            stx();
-        }
-        break;
-        case 0x87: // sax (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            sax();
-        }
-        break;
-        case 0x88: // dey 
-        {
-            dey();
-        }
-        break;
-        case 0x89: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x8a: // txa 
-        {
-            txa();
-        }
-        break;
-        case 0x8b: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0x8c: // sty ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            sty();
-        }
-        break;
-        case 0x8d: // sta ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            sta();
-        }
-        break;
-        case 0x8e: // stx ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            stx();
-        }
-        break;
-        case 0x8f: // sax ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            sax();
-        }
-        break;
-        case 0x90: // bcc rea
-        {
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bcc();
-        }
-        break;
-        case 0x91: // sta (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            sta();
-        }
-        break;
-        case 0x92: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0x93: // nop (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            nop();
-        }
-        break;
-        case 0x94: // sty (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            sty();
-        }
-        break;
-        case 0x95: // sta (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            sta();
-        }
-        break;
-        case 0x96: // stx (zp),y
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            stx();
-        }
-        break;
-        case 0x97: // sax (zp),y
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            sax();
-        }
-        break;
-        case 0x98: // tya 
-        {
-            tya();
-        }
-        break;
-        case 0x99: // sta ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            sta();
-        }
-        break;
-        case 0x9a: // txs 
-        {
-            txs();
-        }
-        break;
-        case 0x9b: // nop ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            nop();
-        }
-        break;
-        case 0x9c: // noP ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0x9d: // sta ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            sta();
-        }
-        break;
-        case 0x9e: // nop ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            nop();
-        }
-        break;
-        case 0x9f: // nop ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            nop();
-        }
-        break;
-        case 0xa0: // ldy #imm
-        {
-            ea = pc++;
-            ldy();
-        }
-        break;
-        case 0xa1: // lda (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            lda();
-        }
-        break;
-        case 0xa2: // ldx #imm
-        {
-            ea = pc++;
-            ldx();
-        }
-        break;
-        case 0xa3: // lax (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            lax();
-        }
-        break;
-        case 0xa4: // ldy (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            ldy();
-        }
-        break;
-        case 0xa5: // lda (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            lda();
-        }
-        break;
-        case 0xa6: // ldx (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            ldx();
-        }
-        break;
-        case 0xa7: // lax (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            lax();
-        }
-        break;
-        case 0xa8: // tay 
-        {
-            tay();
-        }
-        break;
-        case 0xa9: // lda #imm
-        {
-            ea = pc++;
-            lda();
-        }
-        break;
-        case 0xaa: // tax 
-        {
-            tax();
-        }
-        break;
-        case 0xab: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0xac: // ldy ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            ldy();
-        }
-        break;
-        case 0xad: // lda ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            lda();
-        }
-        break;
-        case 0xae: // ldx ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            ldx();
-        }
-        break;
-        case 0xaf: // lax ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            lax();
-        }
-        break;
-        case 0xb0: // bcs rea
-        {
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bcs();
-        }
-        break;
-        case 0xb1: // lda (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            lda();
-        }
-        break;
-        case 0xb2: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0xb3: // lax (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            lax();
-        }
-        break;
-        case 0xb4: // ldy (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            ldy();
-        }
-        break;
-        case 0xb5: // lda (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            lda();
-        }
-        break;
-        case 0xb6: // ldx (zp),y
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            ldx();
-        }
-        break;
-        case 0xb7: // lax (zp),y
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            lax();
-        }
-        break;
-        case 0xb8: // clv 
-        {
-            clv();
-        }
-        break;
-        case 0xb9: // lda ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            lda();
-        }
-        break;
-        case 0xba: // tsx 
-        {
-            tsx();
-        }
-        break;
-        case 0xbb: // lax ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            lax();
-        }
-        break;
-        case 0xbc: // ldy ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            ldy();
-        }
-        break;
-        case 0xbd: // lda ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            lda();
-        }
-        break;
-        case 0xbe: // ldx ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            ldx();
-        }
-        break;
-        case 0xbf: // lax ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            lax();
-        }
-        break;
-        case 0xc0: // cpy #imm
-        {
-            ea = pc++;
-            cpy();
-        }
-        break;
-        case 0xc1: // cmp (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            cmp();
-        }
-        break;
-        case 0xc2: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0xc3: // dcp (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            dcp();
-        }
-        break;
-        case 0xc4: // cpy (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            cpy();
-        }
-        break;
-        case 0xc5: // cmp (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            cmp();
-        }
-        break;
-        case 0xc6: // dec (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            dec();
-        }
-        break;
-        case 0xc7: // dcp (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            dcp();
-        }
-        break;
-        case 0xc8: // iny 
-        {
-            iny();
-        }
-        break;
-        case 0xc9: // cmp #imm
-        {
-            ea = pc++;
-            cmp();
-        }
-        break;
-        case 0xca: // dex 
-        {
-            dex();
-        }
-        break;
-        case 0xcb: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0xcc: // cpy ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            cpy();
-        }
-        break;
-        case 0xcd: // cmp ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            cmp();
-        }
-        break;
-        case 0xce: // dec ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            dec();
-        }
-        break;
-        case 0xcf: // dcp ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            dcp();
-        }
-        break;
-        case 0xd0: // bne rea
-        {
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            bne();
-        }
-        break;
-        case 0xd1: // cmp (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            cmp();
-        }
-        break;
-        case 0xd2: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0xd3: // dcp (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            dcp();
-        }
-        break;
-        case 0xd4: // nop (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0xd5: // cmp (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            cmp();
-        }
-        break;
-        case 0xd6: // dec (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            dec();
-        }
-        break;
-        case 0xd7: // dcp (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            dcp();
-        }
-        break;
-        case 0xd8: // cld 
-        {
-            cld();
-        }
-        break;
-        case 0xd9: // cmp ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            cmp();
-        }
-        break;
-        case 0xda: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0xdb: // dcp ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            dcp();
-        }
-        break;
-        case 0xdc: // noP ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0xdd: // cmp ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            cmp();
-        }
-        break;
-        case 0xde: // dec ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            dec();
-        }
-        break;
-        case 0xdf: // dcp ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            dcp();
-        }
-        break;
-        case 0xe0: // cpx #imm
-        {
-            ea = pc++;
-            cpx();
-        }
-        break;
-        case 0xe1: // sbc (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            sbc();
-        }
-        break;
-        case 0xe2: // nop #imm
-        {
-            ea = pc++;
-            nop();
-        }
-        break;
-        case 0xe3: // isb (ea,x)
-        {
-            uint16_t u = (uint16_t)(((uint16_t)peek(pc++) + (uint16_t)x) & 0xFF);
-            ea = (uint16_t)peek(u & 0xFF) | ((uint16_t)peek((u + 1) & 0xFF) << 8);
-            isb();
-        }
-        break;
-        case 0xe4: // cpx (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            cpx();
-        }
-        break;
-        case 0xe5: // sbc (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            sbc();
-        }
-        break;
-        case 0xe6: // inc (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            inc();
-        }
-        break;
-        case 0xe7: // isb (zp)
-        {
-            ea = (uint16_t)peek(pc++);
-            isb();
-        }
-        break;
-        case 0xe8: // inx 
-        {
-            inx();
-        }
-        break;
-        case 0xe9: // sbc #imm
-        {
-            ea = pc++;
-            sbc();
-        }
-        break;
-        case 0xea: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0xeb: // sbc #imm
-        {
-            ea = pc++;
-            sbc();
-        }
-        break;
-        case 0xec: // cpx ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            cpx();
-        }
-        break;
-        case 0xed: // sbc ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            sbc();
-        }
-        break;
-        case 0xee: // inc ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            inc();
-        }
-        break;
-        case 0xef: // isb ea
-        {
-            ea = (uint16_t)peek(pc++) | ((uint16_t)peek(pc++)<<8);
-            isb();
-        }
-        break;
-        case 0xf0: // beq rea
-        {
-            ra = (uint16_t)peek(pc++); if (ra&0x80) ra |= 0xFF00;
-            beq();
-        }
-        break;
-        case 0xf1: // sbc (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            sbc();
-        }
-        break;
-        case 0xf2: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0xf3: // isb (ea),y
-        {
-            uint16_t u = (uint16_t)peek(pc++);
-            uint16_t v = (u & 0xFF00) | ((u + 1) & 0x00FF);
-            ea = (uint16_t)peek(u) | ((uint16_t)peek(v) << 8);
-            ea += (uint16_t)y;
-            isb();
-        }
-        break;
-        case 0xf4: // nop (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            nop();
-        }
-        break;
-        case 0xf5: // sbc (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            sbc();
-        }
-        break;
-        case 0xf6: // inc (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            inc();
-        }
-        break;
-        case 0xf7: // isb (zp),x
-        {
-            ea = ((uint16_t)peek(pc++) + (uint16_t)x) & 0xff;
-            isb();
-        }
-        break;
-        case 0xf8: // sed 
-        {
-            sed();
-        }
-        break;
-        case 0xf9: // sbc ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            sbc();
-        }
-        break;
-        case 0xfa: // nop 
-        {
-            nop();
-        }
-        break;
-        case 0xfb: // isb ea,y
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)y;
-            isb();
-        }
-        break;
-        case 0xfc: // noP ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            noP();
-        }
-        break;
-        case 0xfd: // sbc ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            sbc();
-        }
-        break;
-        case 0xfe: // inc ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            inc();
-        }
-        break;
-        case 0xff: // isb ea,x
-        {
-            ea = ((uint16_t)peek(pc++) | ((uint16_t)peek(pc++) << 8)); ea += (uint16_t)x;
-            isb();
-        }
-        break;
     }
+    cycles = 0;
+    return -budget;
+}
+
+void MC6502::fastclock()
+{
+    fastrun(1);
 }
@@ -11,6 +11,8 @@ https://github.com/dirkwhoffmann/virtualc64/blob/master/Emulator/CPU/CPUInstruct
 #define CPU_H
 
 #include <stdint.h>
+#include <vector>
+#include "condition.h"
 
 #define likely(x)       __builtin_expect((x),1)
 #define unlikely(x)     __builtin_expect((x),0)
@@ -25,35 +27,52 @@ https://github.com/dirkwhoffmann/virtualc64/blob/master/Emulator/CPU/CPUInstruct
 #define FLAG_SIGN      0x80
 
 extern uint8_t peek(uint16_t address);
+extern uint8_t inspect(uint16_t address); // peek() for the debugger: no watchpoints, no acknowledged irqs or cleared collisions
 extern void poke(uint16_t address, uint8_t value);
+extern uint8_t* RAM;
 
 #define getvalue16() ((uint16_t)peek(ea) | ((uint16_t)peek(ea+1) << 8))
 
-#define push8(__val__) poke(0x100 + sp--, __val__)
-#define pull8() (uint8_t)(peek(0x100 + ++sp))
+#define push8(__val__) write(0x100 + sp--, __val__)
+#define pull8() (uint8_t)(read(0x100 + ++sp))
 
 #define setcarry() status |= (FLAG_CARRY|FLAG_CONSTANT)
 #define clearcarry() status &= (~FLAG_CARRY)
-#define setzero() status |= (FLAG_ZERO|FLAG_CONSTANT)
-#define clearzero() status &= (~FLAG_ZERO)
 #define setinterrupt() status |= (FLAG_INTERRUPT|FLAG_CONSTANT)
 #define clearinterrupt() status &= (~FLAG_INTERRUPT)
 #define setdecimal() status |= (FLAG_DECIMAL|FLAG_CONSTANT)
 #define cleardecimal() status &= (~FLAG_DECIMAL)
 #define setoverflow() status |= (FLAG_OVERFLOW|FLAG_CONSTANT)
 #define clearoverflow() status &= (~FLAG_OVERFLOW)
-#define setsign() status |= (FLAG_SIGN|FLAG_CONSTANT)
-#define clearsign() status &= (~FLAG_SIGN)
 
+#if defined(CPU_LAZY_FLAGS)
+
+// Z and N are not computed by the instructions, only the bytes they derive from are kept
+// in zres and nres. flags() folds them into the status byte when it is actually read.
+#define FLAGS_ZN 0
 
 #define zerocalc(n) {\
-    if (((n) & 0x00FF)==0) setzero();\
+    zres = (uint8_t)(n);\
 }
 
 #define signcalc(n) {\
-    status |= n&0x80;\
+    nres = (uint8_t)(n);\
+}
+
+#else
+
+#define FLAGS_ZN (FLAG_ZERO|FLAG_SIGN)
+
+#define zerocalc(n) {\
+    if (((n) & 0x00FF)==0) status |= (FLAG_ZERO|FLAG_CONSTANT);\
 }
 
+#define signcalc(n) {\
+    status |= (n)&0x80;\
+}
+
+#endif
+
 #define carrycalc(n) {\
     status |= (n>>8)&1;\
 }
@@ -70,17 +89,44 @@ struct Breakpoint
         CONDITION_A=4,
         CONDITION_X=8,
         CONDITION_Y=16,
+        READ=32,    // watchpoint on reads of pc instead of an execution breakpoint
+        WRITE=64,   // watchpoint on writes to pc
+        EXPRESSION=128,
     };
     uint16_t pc;
     uint8_t a,x,y,flags;
+    uint32_t hits;          // times the address was reached, for the condition
+    Condition condition;    // tested when EXPRESSION is set
 };
 
 struct MC6502 {
     int16_t cycles;
     uint16_t pc,ea,ra;
     uint8_t sp,a,x,y,status,opcode;
+    bool taken; // the last branch instruction branched
     int cyclehack;
     uint32_t clockcycles;
+#if defined(CPU_LAZY_FLAGS)
+    uint8_t zres,nres; // Z is set when zres is 0, N is bit 7 of nres
+#endif
+
+    // the status register as the 6502 sees it, use these instead of status for Z and N
+    inline uint8_t flags() const
+    {
+#if defined(CPU_LAZY_FLAGS)
+        return (status & ~(FLAG_ZERO|FLAG_SIGN)) | (zres ? 0 : FLAG_ZERO) | (nres & FLAG_SIGN);
+#else
+        return status;
+#endif
+    }
+    inline void setflags(uint8_t value)
+    {
+        status = value;
+#if defined(CPU_LAZY_FLAGS)
+        zres = ~value & FLAG_ZERO;
+        nres = value;
+#endif
+    }
 
     struct {
         uint16_t pc;
@@ -88,28 +134,103 @@ struct MC6502 {
     } last;
     
     uint8_t paused;
-    static const int BREAKPOINT_COUNT = 20;
-    Breakpoint breakpoints[BREAKPOINT_COUNT];
-    int n_breakpoints;
+    // breakpoints and watchpoints: a bitmap per kind is tested first, the conditions are in the side table
+    enum { BREAK_EXEC, BREAK_READ, BREAK_WRITE };
+    std::vector<Breakpoint> breakpoints;
+    uint8_t* breakmap[3];   // one bit per address, allocated when the first breakpoint of the kind is armed
+    int n_breakpoints;      // armed execution breakpoints
+    int n_watchpoints;      // armed read and write watchpoints
+    uint16_t direct;        // read() and write() go straight to RAM below, $0200 or 0 while watchpoints are armed
     void addBreakpoint(uint16_t _pc, uint8_t _flags=Breakpoint::ENABLE, uint8_t _a=0, uint8_t _x=0, uint8_t _y=0);
-    void removeBreakpoint(uint16_t _pc);
+    void addBreakpoint(uint16_t _pc, const Condition& _condition, uint8_t _flags=Breakpoint::ENABLE);
+    void removeBreakpoint(uint16_t _pc, uint8_t _flags=0);
     Breakpoint* hitsBreakpoint();
+    Breakpoint* watch(int kind, uint16_t address); // for peek() and poke(), a hit stops run() after the instruction
+    Breakpoint* triggered(Breakpoint* bp);
     void (*onHit)(Breakpoint*);
-    Breakpoint* findBreakpoint(uint16_t _pc);
+    Breakpoint* findBreakpoint(uint16_t _pc, uint8_t _flags=0); // _flags selects the kind, READ, WRITE or neither
+    bool marked(int kind, uint16_t address) const
+    {
+        return breakmap[kind][address>>3] & (1<<(address&7));
+    }
+    bool watched(int kind, uint16_t address) const
+    {
+        return unlikely(n_watchpoints>0) && marked(kind,address);
+    }
 
     static uint16_t swap(uint16_t v)
     {
         return ((v>>8)&255) | ((v&255)<<8);
     }
 
+    // kernal patcher: any pc can be trapped, a bitmap with one bit per address is tested before each instruction
+    struct Patch {
+        uint16_t ea;
+        void (*func)(const char* name);
+        const char* name;
+    };
+    std::vector<Patch> patches; // sorted by ea
+    uint8_t patched[0x10000/8];
+    bool patching;
     void setpatch(uint16_t ea, void (*func)(const char* name),const char* name);
+    void removepatch(uint16_t ea);
     void enable_patches(int on);
+    bool ispatched(uint16_t address) const
+    {
+        return patched[address>>3] & (1<<(address&7));
+    }
+    void trap(); // runs the patch at pc, it may move pc on, e.g. by returning from the routine
     void reset();
-    void irq();
+    void irq();  // enters the irq handler right away unless masked
     void init();
     void nmi();
+
+    // interrupt lines, one bit per source. irq is level triggered and held until the chip is
+    // acknowledged, nmi triggers on the edge. run() samples them once before each instruction
+    enum { IRQ_VIC=1, IRQ_CIA1=2, NMI_CIA2=1 };
+    uint8_t irqline;
+    uint8_t nmiline;
+    bool nmiedge;
+    void setirq(uint8_t source, bool level)
+    {
+        if (level) irqline |= source; else irqline &= ~source;
+    }
+    void setnmi(uint8_t source, bool level)
+    {
+        if (level && nmiline==0) nmiedge = true;
+        if (level) nmiline |= source; else nmiline &= ~source;
+    }
+    void interrupt();
     void clock();
     void fastclock();
+    void fastrun(uint32_t count, int32_t until=-1); // up to count instructions, stops early when pc reaches until
+    int32_t run(int32_t _budget); // whole instructions until budget cycles are spent, returns the overshoot
+    template <bool DEBUG> int32_t runloop(); // run() without any breakpoint test unless DEBUG
+    int32_t budget;              // what is left of run()'s budget, counted from the instruction being executed
+    int32_t cut;                 // cycles shorten() took from the last run(), the segment ends that much earlier
+    // a chip needs the cpu to stop n cycles after the instruction being executed started, e.g. for an irq
+    void shorten(int32_t n)
+    {
+        if (budget>n)
+        {
+            cut += budget-n;
+            budget = n;
+        }
+    }
+    Breakpoint* stopped;         // breakpoint the last run() stopped at, the unspent budget is returned negative
+
+    // idle loop detection in run(): a short backward jump that arrives at the same loop head with the
+    // same registers, while nothing changed RAM, touched I/O or interrupted, spins until the next event
+    static const int IDLE_LOOP_SIZE = 32;
+    struct {
+        uint16_t pc;
+        uint8_t sp,a,x,y,status;
+        bool dirty;     // set by RAM writes that change a value, I/O accesses and interrupts
+    } idle;
+    uint32_t idlecycles; // cycles skipped by run(), for the statistics
+    bool idling();
+    // single steps from the monitor: watch() ignores the monitor's own reads while paused, but not the
+    // accesses of the stepped instructions, a watchpoint hit is left in stopped
     void stepIn()
     {
         last.pc = pc;
@@ -117,9 +238,13 @@ struct MC6502 {
         last.a = a;
         last.x = x;
         last.y = y;
-        last.status = status;
+        last.status = flags();
+        uint8_t looking = paused;
+        paused = 0;
+        stopped = nullptr;
         cycles=1;
         clock();
+        paused = looking;
     }
     void stepOut()
     {
@@ -128,13 +253,17 @@ struct MC6502 {
         last.a = a;
         last.x = x;
         last.y = y;
-        last.status = status;
+        last.status = flags();
+        uint8_t looking = paused;
+        paused = 0;
+        stopped = nullptr;
         do
         {
             cycles=1;
             clock();
         }
-        while ((opcode!=0x40) && (opcode!=0x60) && (last.pc != pc));   // RTS=0x60, RTI=0x40 and avoid infinite loop
+        while ((opcode!=0x40) && (opcode!=0x60) && (last.pc != pc) && stopped==nullptr);   // RTS=0x60, RTI=0x40 and avoid infinite loop
+        paused = looking;
     }
     void stepOver()
     {
@@ -149,19 +278,247 @@ struct MC6502 {
     }
     uint16_t getEffectiveAddress();
 
-    
+    // addressing modes, see CPU_OPCODES in cpu.cpp
+    enum Mode {
+        IMPLIED,
+        ACCUMULATOR,
+        IMMEDIATE,
+        ZEROPAGE,
+        ZEROPAGE_X,
+        ZEROPAGE_Y,
+        ABSOLUTE,
+        ABSOLUTE_X,
+        ABSOLUTE_Y,
+        INDIRECT,
+        INDIRECT_X,
+        INDIRECT_Y,
+        RELATIVE,
+    };
+
+    struct Opcode {
+        uint8_t mode;
+        uint8_t cycles;   // base cycles
+        uint8_t penalty;  // +1 cycle when indexing crosses a page
+    };
+    static const Opcode opcodes[256];
+
+    // pre-decoded instruction of an immutable (ROM) region, see decode()
+    struct Decoded {
+        uint8_t opcode;
+        uint8_t length;   // 0 when the instruction leaves the region, fetched through peek() then
+        uint16_t operand; // as returned by fetch()
+    };
+
+    // per-opcode handlers, generated from CPU_OPCODES, [0] fast, [1] cycle-counted
+    // the operand comes from the Decoded entry or, when that is nullptr, from memory
+    typedef void (MC6502::*handler_t)(const Decoded*);
+    static const handler_t* const handlers[2];
+
+    // decode cache per 4K page, pre-offset like the memory mappings: code[pc>>12][pc]
+    // nullptr for pages fetched through peek(), the owner of the memory mapping keeps them up to date
+    const Decoded* code[16];
+
+    // decode every address of a ROM image mapped at base, returns the pre-offset cache or nullptr
+    static const Decoded* decode(const uint8_t* rom, uint16_t base, uint16_t size);
+
+#if defined(CPU_BLOCK_CACHE)
+    // RAM code decoded on first execution, one straight-line block at a time, kept per page.
+    // A write to a decoded instruction drops its entry, pages written to that often stay interpreted.
+    struct BlockCache {
+        static const int BUFFERS = 16;        // pages held at once, recycled round robin
+        static const uint8_t SMC_LIMIT = 16;  // self-modifying writes after which a page is left to the interpreter
+        static const uint8_t EXCLUDED = 0xFF;
+
+        Decoded* page[256];         // pre-offset like code[], nullptr when the page is not cached
+        Decoded* buffer[BUFFERS];
+        int16_t owner[BUFFERS];     // page using the buffer or -1
+        uint8_t next;
+        uint8_t writes[256];        // self-modifying writes per page, SMC_LIMIT and more disable the page
+        uint32_t hits, misses;      // instructions from the cache, instructions fetched through peek()
+
+        void flush();
+        void exclude(uint8_t first, uint8_t last);
+        void invalidate(uint16_t address, uint32_t size);
+        void drop(uint8_t p);
+        void write(uint16_t address);
+        inline void invalidate(uint16_t address)
+        {
+            if (page[address>>8]) write(address);
+        }
+    } blocks;
+
+    const Decoded* translate();
+#endif
+
+    // RAM was written, through poke() or behind the cpu's back (loaders), keeps decoded RAM code in sync
+    inline void invalidate(uint16_t address)
+    {
+#if defined(CPU_BLOCK_CACHE)
+        blocks.invalidate(address);
+#endif
+    }
+    inline void invalidate(uint16_t address, uint32_t size)
+    {
+#if defined(CPU_BLOCK_CACHE)
+        blocks.invalidate(address,size);
+#endif
+    }
+
+    inline const Decoded* decoded()
+    {
+        const Decoded* d = code[pc>>12];
+        if (d==nullptr)
+        {
+#if defined(CPU_BLOCK_CACHE)
+            d = blocks.page[pc>>8];
+            if (d && d[pc].length)
+            {
+                blocks.hits++;
+                return d+pc;
+            }
+            if (blocks.writes[pc>>8]<BlockCache::SMC_LIMIT) return translate();
+            blocks.misses++;
+#endif
+            return nullptr;
+        }
+        d += pc;
+        return d->length ? d : nullptr;
+    }
+
+// fetch the operand bytes following the opcode, MODE is resolved at compile time
+// immediate operands are returned as their address
+template <int MODE>
+inline uint16_t fetch()
+{
+    uint16_t operand;
+    switch(MODE)
+    {
+        case IMMEDIATE:
+            return pc++;
+        case ZEROPAGE:
+        case ZEROPAGE_X:
+        case ZEROPAGE_Y:
+        case INDIRECT_X:
+        case INDIRECT_Y:
+        case RELATIVE:
+            return peek(pc++);
+        case ABSOLUTE:
+        case ABSOLUTE_X:
+        case ABSOLUTE_Y:
+        case INDIRECT:
+            operand = (uint16_t)peek(pc) | ((uint16_t)peek(pc+1) << 8);
+            pc += 2;
+            return operand;
+        default: // IMPLIED, ACCUMULATOR
+            return 0;
+    }
+}
+
+// calculate the effective address from the operand
+// returns 1 when indexing crossed a page boundary
+template <int MODE>
+inline uint8_t address(uint16_t operand)
+{
+    switch(MODE)
+    {
+        case IMMEDIATE:
+        case ZEROPAGE:
+        case ABSOLUTE:
+            ea = operand;
+            break;
+        case ZEROPAGE_X:
+            ea = (operand + (uint16_t)x) & 0xff;
+            break;
+        case ZEROPAGE_Y:
+            ea = (operand + (uint16_t)y) & 0xff;
+            break;
+        case ABSOLUTE_X:
+            ea = operand + (uint16_t)x;
+            return ((operand ^ ea) >> 8) != 0;
+        case ABSOLUTE_Y:
+            ea = operand + (uint16_t)y;
+            return ((operand ^ ea) >> 8) != 0;
+        case INDIRECT:
+        {
+            uint16_t v = (operand & 0xFF00) | ((operand + 1) & 0xFF); // replicate 6502 page boundary wraparound bug
+            ea = (uint16_t)peek(operand) | ((uint16_t)peek(v) << 8);
+        }
+            break;
+        case INDIRECT_X:
+        {
+            uint16_t u = (uint16_t)((operand + (uint16_t)x) & 0xFF);
+            ea = (uint16_t)read(u & 0xFF) | ((uint16_t)read((u + 1) & 0xFF) << 8);
+        }
+            break;
+        case INDIRECT_Y:
+        {
+            uint16_t base = (uint16_t)read(operand) | ((uint16_t)read((operand + 1) & 0x00FF) << 8);
+            ea = base + (uint16_t)y;
+            return ((base ^ ea) >> 8) != 0;
+        }
+        case RELATIVE:
+            ra = operand; if (ra&0x80) ra |= 0xFF00;
+            break;
+        default: // IMPLIED, ACCUMULATOR
+            break;
+    }
+    return 0;
+}
+
+// one instruction, CYCLED reloads the cycle countdown of clock(), both variants keep clockcycles
+template <int MODE, int CYCLES, int PENALTY, void (MC6502::*OPERATION)(), bool CYCLED>
+void execute(uint16_t operand)
+{
+    uint8_t n = CYCLES + (address<MODE>(operand) & PENALTY);
+    uint16_t next = pc;
+    (this->*OPERATION)();
+    if (MODE==RELATIVE && taken)
+    {
+        n += 1 + (((pc ^ next) >> 8) != 0); // branch taken, one more when crossing a page
+    }
+    clockcycles += n;
+    if (CYCLED) cycles = n;
+}
+
+template <int MODE, int CYCLES, int PENALTY, void (MC6502::*OPERATION)(), bool CYCLED>
+void execute(const Decoded* d)
+{
+    execute<MODE,CYCLES,PENALTY,OPERATION,CYCLED>(d ? d->operand : fetch<MODE>());
+}
+
+template <bool CYCLED> void step();
+
+
+// zeropage and stack are plain RAM, only writes to the processor port at $00/$01 need poke()
+inline uint8_t read(uint16_t address)
+{
+    if (address < direct) return RAM[address];
+    return peek(address);
+}
+
+inline void write(uint16_t address, uint8_t value)
+{
+    if (address < direct && address > 1)
+    {
+        if (RAM[address] != value) idle.dirty = true;
+        RAM[address] = value;
+        return;
+    }
+    poke(address, value);
+}
+
 // a few general functions used by various other functions
 inline void push16(uint16_t pushval)
 {
-    poke(0x100 + sp, (pushval >> 8) & 0xFF);
-    poke(0x100 + ((sp - 1) & 0xFF), pushval & 0xFF);
+    write(0x100 + sp, (pushval >> 8) & 0xFF);
+    write(0x100 + ((sp - 1) & 0xFF), pushval & 0xFF);
     sp -= 2;
 }
 
 
 inline uint16_t pull16()
 {
-    uint16_t t = peek(0x100 + ((sp + 1) & 0xFF)) | ((uint16_t)peek(0x100 + ((sp + 2) & 0xFF)) << 8);
+    uint16_t t = read(0x100 + ((sp + 1) & 0xFF)) | ((uint16_t)read(0x100 + ((sp + 2) & 0xFF)) << 8);
     sp += 2;
     return t;
 }
@@ -169,7 +526,7 @@ inline uint16_t pull16()
 //instruction handler functions
 inline void adc()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = (uint16_t)a + value + (uint16_t)(status & FLAG_CARRY);
    
     if (unlikely(status & FLAG_DECIMAL)) {
@@ -186,9 +543,9 @@ inline void adc()
             hi++;
         }
         
-        status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_OVERFLOW|FLAG_SIGN);
-        if ((result & 0xFF) == 0) setzero();
-        if (hi & 0x08) setsign();
+        status &=~ (FLAG_CARRY|FLAG_OVERFLOW|FLAGS_ZN);
+        zerocalc(result);
+        signcalc(hi << 4);
         if ((((hi << 4) ^ a) & 0x80) && !((a ^ value) & 0x80)) setoverflow();
         
         if (hi > 9) {
@@ -201,7 +558,7 @@ inline void adc()
         a = (uint8_t)((hi << 4) | lo);
         return;
     }
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_OVERFLOW|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAG_OVERFLOW|FLAGS_ZN);
     carrycalc(result);
     zerocalc(result);
     overflowcalc(result, a, value);
@@ -212,10 +569,10 @@ inline void adc()
 
 inline void And()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = (uint16_t)a & value;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(result);
     signcalc(result);
    
@@ -224,15 +581,15 @@ inline void And()
 
 inline void asl()
 {
-    uint16_t value = (uint16_t)peek(ea);
+    uint16_t value = (uint16_t)read(ea);
     uint16_t result = value << 1;
 
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     carrycalc(result);
     zerocalc(result);
     signcalc(result);
    
-    poke(ea,result);
+    write(ea,result);
 }
 
 inline void asl_a()
@@ -240,7 +597,7 @@ inline void asl_a()
     uint16_t value = (uint16_t)a;
     uint16_t result = value << 1;
 
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     carrycalc(result);
     zerocalc(result);
     signcalc(result);
@@ -248,74 +605,52 @@ inline void asl_a()
     a=(uint8_t)result;
 }
 
+// taken is kept for execute(), a taken branch costs one more cycle even when it lands on the next instruction
+inline void branch(bool condition)
+{
+    taken = condition;
+    if (condition) pc += ra;
+}
+
 inline void bcc()
 {
-    if ((status & FLAG_CARRY) == 0) {
-        //oldpc = pc;
-        pc += ra;
-//        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-//            else clockticks6502++;
-    }
+    branch((status & FLAG_CARRY) == 0);
 }
 
 inline void bcs()
 {
-    if ((status & FLAG_CARRY) == FLAG_CARRY) {
-        //oldpc = pc;
-        pc += ra;
-//        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-//            else clockticks6502++;
-    }
+    branch((status & FLAG_CARRY) == FLAG_CARRY);
 }
 
 inline void beq()
 {
-    if ((status & FLAG_ZERO) == FLAG_ZERO) {
-        //oldpc = pc;
-        pc += ra;
-//        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-//            else clockticks6502++;
-    }
+    branch((flags() & FLAG_ZERO) == FLAG_ZERO);
 }
 
 inline void Bit()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = (uint16_t)a & value;
    
-    status &=~ (FLAG_ZERO);
+    status &=~ (FLAG_OVERFLOW|FLAGS_ZN);
     zerocalc(result);
-    status = (status & 0x3F) | (value & 0xC0);
+    signcalc(value);
+    status |= value & FLAG_OVERFLOW;
 }
 
 inline void bmi()
 {
-    if ((status & FLAG_SIGN) == FLAG_SIGN) {
-        //oldpc = pc;
-        pc += ra;
-//        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-//            else clockticks6502++;
-    }
+    branch((flags() & FLAG_SIGN) == FLAG_SIGN);
 }
 
 inline void bne()
 {
-    if ((status & FLAG_ZERO) == 0) {
-        //oldpc = pc;
-        pc += ra;
-//        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-//            else clockticks6502++;
-    }
+    branch((flags() & FLAG_ZERO) == 0);
 }
 
 inline void bpl()
 {
-    if ((status & FLAG_SIGN) == 0) {
-        //oldpc = pc;
-        pc += ra;
-//        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-//            else clockticks6502++;
-    }
+    branch((flags() & FLAG_SIGN) == 0);
 }
 
 inline void brk()
@@ -323,29 +658,19 @@ inline void brk()
     pc++;
     status |= FLAG_CONSTANT;
     push16(pc); //push next instruction address onto stack
-    push8(status | FLAG_BREAK); //push CPU status to stack
+    push8(flags() | FLAG_BREAK); //push CPU status to stack
     setinterrupt(); //set interrupt flag
     pc = (uint16_t)peek(0xFFFE) | ((uint16_t)peek(0xFFFF) << 8);
 }
 
 inline void bvc()
 {
-    if ((status & FLAG_OVERFLOW) == 0) {
-        //oldpc = pc;
-        pc += ra;
-//        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-//            else clockticks6502++;
-    }
+    branch((status & FLAG_OVERFLOW) == 0);
 }
 
 inline void bvs()
 {
-    if ((status & FLAG_OVERFLOW) == FLAG_OVERFLOW) {
-        //oldpc = pc;
-        pc += ra;
-//        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-//            else clockticks6502++;
-    }
+    branch((status & FLAG_OVERFLOW) == FLAG_OVERFLOW);
 }
 
 inline void clc()
@@ -370,54 +695,54 @@ inline void clv()
 
 inline void cmp()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = (uint16_t)a - value;
    
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     if (unlikely(a >= (uint8_t)(value & 0x00FF))) setcarry();
-    if (unlikely(a == (uint8_t)(value & 0x00FF))) setzero();
+    zerocalc(result);
     signcalc(result);
 }
 
 inline void cpx()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = (uint16_t)x - value;
    
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     if (unlikely(x >= (uint8_t)(value & 0x00FF))) setcarry();
-    if (unlikely(x == (uint8_t)(value & 0x00FF))) setzero();
+    zerocalc(result);
     signcalc(result);
 }
 
 inline void cpy()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = (uint16_t)y - value;
    
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     if (unlikely(y >= (uint8_t)(value & 0x00FF))) setcarry();
-    if (unlikely(y == (uint8_t)(value & 0x00FF))) setzero();
+    zerocalc(result);
     signcalc(result);
 }
 
 inline void dec()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = value - 1;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(result);
     signcalc(result);
    
-    poke(ea,result);
+    write(ea,result);
 }
 
 inline void dex()
 {
     x--;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(x);
     signcalc(x);
 }
@@ -426,17 +751,17 @@ inline void dey()
 {
     y--;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(y);
     signcalc(y);
 }
 
 inline void eor()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = (uint16_t)a ^ value;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(result);
     signcalc(result);
    
@@ -445,21 +770,21 @@ inline void eor()
 
 inline void inc()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = value + 1;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(result);
     signcalc(result);
    
-    poke(ea,result);
+    write(ea,result);
 }
 
 inline void inx()
 {
     x++;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(x);
     signcalc(x);
 }
@@ -468,7 +793,7 @@ inline void iny()
 {
     y++;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(y);
     signcalc(y);
 }
@@ -478,45 +803,45 @@ void jsr();
 
 inline void lda()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     a = (uint8_t)(value & 0x00FF);
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(a);
     signcalc(a);
 }
 
 inline void ldx()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     x = (uint8_t)(value & 0x00FF);
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(x);
     signcalc(x);
 }
 
 inline void ldy()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     y = (uint8_t)(value & 0x00FF);
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(y);
     signcalc(y);
 }
 
 inline void lsr()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = value >> 1;
    
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     if (value & 1) setcarry();
     zerocalc(result);
     signcalc(result);
    
-    poke(ea,result);
+    write(ea,result);
 }
 
 inline void lsr_a()
@@ -524,7 +849,7 @@ inline void lsr_a()
     uint16_t value = (uint16_t)a;
     uint16_t result = value >> 1;
    
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     if (value & 1) setcarry();
     zerocalc(result);
     signcalc(result);
@@ -541,10 +866,10 @@ inline void noP()
 
 inline void ora()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = (uint16_t)a | value;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(result);
     signcalc(result);
    
@@ -558,34 +883,34 @@ inline void pha()
 
 inline void php()
 {
-    push8(status);// | FLAG_BREAK);
+    push8(flags());// | FLAG_BREAK);
 }
 
 inline void pla()
 {
     a = pull8();
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(a);
     signcalc(a);
 }
 
 inline void plp()
 {
-    status = pull8() | FLAG_CONSTANT;
+    setflags(pull8() | FLAG_CONSTANT);
 }
 
 inline void rol()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = (value << 1) | (status & FLAG_CARRY);
    
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     carrycalc(result);
     zerocalc(result);
     signcalc(result);
    
-    poke(ea,result);
+    write(ea,result);
 }
 
 inline void rol_a()
@@ -593,7 +918,7 @@ inline void rol_a()
     uint16_t value =  (uint16_t)a;
     uint16_t result = (value << 1) | (status & FLAG_CARRY);
    
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     carrycalc(result);
     zerocalc(result);
     signcalc(result);
@@ -602,15 +927,15 @@ inline void rol_a()
 
 inline void ror()
 {
-    uint16_t value = peek(ea);
+    uint16_t value = read(ea);
     uint16_t result = (value >> 1) | ((status & FLAG_CARRY) << 7);
    
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     if (value & 1) setcarry();
     zerocalc(result);
     signcalc(result);
    
-    poke(ea,result);
+    write(ea,result);
 }
 
 inline void ror_a()
@@ -618,7 +943,7 @@ inline void ror_a()
     uint16_t value =  (uint16_t)a;
     uint16_t result = (value >> 1) | ((status & FLAG_CARRY) << 7);
    
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAGS_ZN);
     if (value & 1) setcarry();
     zerocalc(result);
     signcalc(result);
@@ -627,7 +952,7 @@ inline void ror_a()
 
 inline void rti()
 {
-    status = pull8() | FLAG_CONSTANT;
+    setflags(pull8() | FLAG_CONSTANT);
     uint16_t value = pull16();
     pc = value;
 }
@@ -640,7 +965,7 @@ inline void rts()
 
 inline void sbc()
 {
-    uint16_t value = peek(ea) ^ 0x00FF;
+    uint16_t value = read(ea) ^ 0x00FF;
     uint16_t result = (uint16_t)a + value + (uint16_t)(status & FLAG_CARRY);
 
     if (unlikely(status & FLAG_DECIMAL)) {
@@ -657,18 +982,18 @@ inline void sbc()
             hi = hi - 6;
         }
         
-        status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_OVERFLOW|FLAG_SIGN);
+        status &=~ (FLAG_CARRY|FLAG_OVERFLOW|FLAGS_ZN);
         if (result < 0x100) setcarry();
         if (((a ^ result) & 0x80) && ((a ^ value) & 0x80)) setoverflow();
-        if ((result & 0xFF) == 0) setzero();
-        if (result & 0x80) setsign();
+        zerocalc(result);
+        signcalc(result);
         
         a = (uint8_t)((hi << 4) | (lo & 0x0f));
 
         return;        
     }
    
-    status &=~ (FLAG_CARRY|FLAG_ZERO|FLAG_OVERFLOW|FLAG_SIGN);
+    status &=~ (FLAG_CARRY|FLAG_OVERFLOW|FLAGS_ZN);
     carrycalc(result);
     zerocalc(result);
     overflowcalc(result, a, value);
@@ -693,24 +1018,24 @@ inline void sei6502()
 
 inline void sta()
 {
-    poke(ea,a);
+    write(ea,a);
 }
 
 inline void stx()
 {
-    poke(ea,x);
+    write(ea,x);
 }
 
 inline void sty()
 {
-    poke(ea,y);
+    write(ea,y);
 }
 
 inline void tax()
 {
     x = a;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(x);
     signcalc(x);
 }
@@ -719,7 +1044,7 @@ inline void tay()
 {
     y = a;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(y);
     signcalc(y);
 }
@@ -728,7 +1053,7 @@ inline void tsx()
 {
     x = sp;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(x);
     signcalc(x);
 }
@@ -737,7 +1062,7 @@ inline void txa()
 {
     a = x;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(a);
     signcalc(a);
 }
@@ -751,7 +1076,7 @@ inline void tya()
 {
     a = y;
    
-    status &=~ (FLAG_ZERO|FLAG_SIGN);
+    status &=~ FLAGS_ZN;
     zerocalc(a);
     signcalc(a);
 }
@@ -764,7 +1089,7 @@ inline void tya()
     inline void sax() {
         sta();
         stx();
-        poke(ea,a & x);
+        write(ea,a & x);
     }
 
     inline void dcp() {
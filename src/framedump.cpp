@@ -0,0 +1,120 @@
+/*
+ * Balster64, hacking a C64 emulator into an ESP32 microcontroller
+ *
+ * Copyright (C) Daniel Balster
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Daniel Balster nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY DANIEL BALSTER ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL DANIEL BALSTER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "framedump.h"
+#include "vic.h"
+#include <stdio.h>
+#include <string.h>
+
+FrameDump framedump;
+
+bool FrameDump::start(fs::File f, Format fmt, uint16_t n)
+{
+  stop();
+  if (!f) return false;
+  file = f;
+  format = fmt;
+  every = n ? n : 1;
+  count = 0;
+  written = 0;
+  row = new uint8_t[SCREEN_WIDTH*3];
+
+  // BT.601 studio range
+  for (int c=0; c<16; ++c)
+  {
+    int r = (VIC::palette[c]>>16) & 0xFF, g = (VIC::palette[c]>>8) & 0xFF, b = VIC::palette[c] & 0xFF;
+    rgb[c][0] = r;
+    rgb[c][1] = g;
+    rgb[c][2] = b;
+    yuv[0][c] = 16 + ((66*r + 129*g + 25*b + 128) >> 8);
+    yuv[1][c] = 128 + ((-38*r - 74*g + 112*b + 128) >> 8);
+    yuv[2][c] = 128 + ((112*r - 94*g - 18*b + 128) >> 8);
+  }
+
+  vic.setup_framebuffer(true);
+  if (format == Y4M)
+  {
+    char header[64];
+    int len = snprintf(header,sizeof(header),"YUV4MPEG2 W%u H%u F50:%u Ip A1:1 C444\n",SCREEN_WIDTH,SCREEN_HEIGHT,every);
+    if (!write((const uint8_t*)header,len)) return false;
+  }
+  return true;
+}
+
+void FrameDump::stop()
+{
+  if (row == nullptr) return;
+  delete[] row;
+  row = nullptr;
+  file.close();
+  vic.setup_framebuffer(false);
+}
+
+bool FrameDump::write(const uint8_t* data, size_t size)
+{
+  if (file.write(data,size) == size) return true;
+  stop(); // the medium is full or gone
+  return false;
+}
+
+void FrameDump::frame()
+{
+  if (row == nullptr) return;
+  if (++count < every) return;
+  count = 0;
+
+  const uint8_t* fb = vic.framebuffer;
+  if (format == PPM)
+  {
+    char header[32];
+    int len = snprintf(header,sizeof(header),"P6\n%u %u\n255\n",SCREEN_WIDTH,SCREEN_HEIGHT);
+    if (!write((const uint8_t*)header,len)) return;
+    for (int y=0; y<SCREEN_HEIGHT; ++y, fb+=SCREEN_WIDTH)
+    {
+      uint8_t* p = row;
+      for (int x=0; x<SCREEN_WIDTH; ++x, p+=3) memcpy(p,rgb[fb[x] & 15],3);
+      if (!write(row,SCREEN_WIDTH*3)) return;
+    }
+  }
+  else
+  {
+    if (!write((const uint8_t*)"FRAME\n",6)) return;
+    for (int plane=0; plane<3; ++plane)
+    {
+      const uint8_t* lut = yuv[plane];
+      const uint8_t* src = fb;
+      for (int y=0; y<SCREEN_HEIGHT; ++y, src+=SCREEN_WIDTH)
+      {
+        for (int x=0; x<SCREEN_WIDTH; ++x) row[x] = lut[src[x] & 15];
+        if (!write(row,SCREEN_WIDTH)) return;
+      }
+    }
+  }
+  written++;
+}
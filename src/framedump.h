@@ -0,0 +1,65 @@
+/*
+ * Balster64, hacking a C64 emulator into an ESP32 microcontroller
+ *
+ * Copyright (C) Daniel Balster
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Daniel Balster nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY DANIEL BALSTER ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL DANIEL BALSTER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FRAMEDUMP_H
+#define FRAMEDUMP_H
+
+#include <stdint.h>
+#include <FS.h>
+
+// writes the VIC framebuffer of every Nth frame to a file, either as concatenated binary PPM pictures
+// or as one YUV4MPEG2 stream (4:4:4) that ffmpeg and most players read directly.
+// all conversion goes through a row buffer allocated by start(), nothing is allocated per frame
+class FrameDump
+{
+public:
+  enum Format { PPM, Y4M };
+
+  bool start(fs::File file, Format format, uint16_t every=1); // enables the VIC framebuffer
+  void frame(); // call after every emulated frame
+  void stop();
+  bool active() { return row != nullptr; }
+
+  uint32_t written; // frames in the file
+
+private:
+  fs::File file;
+  Format format;
+  uint16_t every;
+  uint16_t count;
+  uint8_t* row; // SCREEN_WIDTH*3 bytes
+  uint8_t rgb[16][3];
+  uint8_t yuv[3][16]; // per plane, one value per color
+
+  bool write(const uint8_t* data, size_t size);
+};
+
+extern FrameDump framedump;
+
+#endif
@@ -68,20 +68,45 @@ AsyncWebServer server(80);
 #include "text.h"
 #include "help.h"
 #include "kernalfile.h"
+#include "snapshot.h"
+#include "framedump.h"
 
 
 bool use_ansi = false;
+// warp: frames run back to back instead of every 20ms, the screen is only synced every WARP_SYNC_INTERVAL µs
+#if defined(WARP)
+bool warp = true;
+#else
+bool warp = false;
+#endif
+static const long WARP_SYNC_INTERVAL = 100000;
+static const char* const QUICKSAVE = "/quicksave.b64"; // CTRL-K and CTRL-L, on the internal flash
+// VERIFY"RESUME" runs inside a kernal trap in the middle of a frame, the snapshot is loaded by loop() once the frame is done
+bool resume_pending = false;
+bool resume_sd;
+unsigned long last_sync;
+// a quiet machine (no screen changes, no keys, no sound) runs up to IDLE_BATCH frames per wakeup and sleeps in between
+static const int IDLE_BATCH = 5;
+static const int IDLE_AFTER = 50; // quiet frames before batching starts
+int quiet_frames = 0;
+int sound_writes = 0; // SID and expansion port writes since the last wakeup, batching would bunch them up
+long jitter_sum, jitter_max; // µs the wakeups were late, since the last title bar update
+int jitter_count;
 int debug_io = 0;
 AnsiRenderer* ansi;
 unsigned long last_timestamp;
-long delta_accumulator;
+unsigned long next_frame; // micros() when the next frame is due, advanced by 20ms per frame so late wakeups don't add up
 unsigned long accurracy = 0;
 int frame=0;
+int32_t cpu_overshoot = 0; // cycles the cpu already ran into the next segment
 
 // first index is bit 0..2 of processor port
 // second index are banks 0xA000, 0xD000 and 0xE000 + 0x8000
 // nullptr means I/O mapped
 uint8_t* mappings[8][4];
+// pre-decoded ROM code for the 0xA000 and 0xE000 banks of the mappings above, nullptr for RAM or I/O
+const MC6502::Decoded* code_mappings[8][2];
+static int mapped_index = -1; // mappings[] row the page tables hold, -1 before the first map_pages()
 int curbank = -1;
 uint32_t clocks_in_irq;
 bool count_irq=false;
@@ -92,149 +117,179 @@ SPIClass spi = SPIClass(HSPI);
 
 int serialread(uint8_t *buf, int len);
 void reset();
+void map_pages();
 
 uint8_t peek(uint16_t address)
 {
-  switch(address&0xF000)
+  // watchpoints stop cpu.run() after the instruction
+  if (cpu.watched(MC6502::BREAK_READ,address)) cpu.watch(MC6502::BREAK_READ,address);
+
+  const uint8_t* page = read_pages[address>>8];
+  if (likely(page!=nullptr)) return page[address];
+
+  cpu.idle.dirty = true; // a loop polling I/O is not idle
+  switch( address & 0xF00 )
   {
-    case 0xA000:
-    case 0xB000:
-      return mapped_basic[address];
-    case 0xD000:
-    {
-      if (unlikely(mapped_io!=nullptr))
-      {
-        return mapped_io[address];
-      }
-      else
-      {
-        switch( address & 0xF00 )
-        {
-          case 0x000:
-          case 0x100:
-          case 0x200:
-          case 0x300:
-            return vic.read(address&0x3f);
-
-          case 0x500:
-          case 0x600:
-          case 0x700:
-          case 0x400:
-            return sid.read(address&63);
-            
-          case 0x800:
-          case 0x900:
-          case 0xa00:
-          case 0xb00:
-            return CRAM[address-0xD800];
-
-          case 0xc00:
-            return cia1.read(address&15);
-            
-          case 0xd00:
-            return cia2.read(address&15);
-            
-          case 0xe00:
-          break;
-          case 0xf00:
-            // expansions not supported
-            //return reu.read(address&15);
-            break;
-        }
-      }
-    }
-      break;
-    case 0xE000:
-    case 0xF000:
-      return mapped_kernal[address];
-//    case 0x8000:
-//    case 0x9000:
-//      return mapped_8000[address];
-      
-    default:
+    case 0x000:
+    case 0x100:
+    case 0x200:
+    case 0x300:
+      return vic.read(address&0x3f);
+
+    case 0x500:
+    case 0x600:
+    case 0x700:
+    case 0x400:
+      return sid.read(address&63);
+
+    // color RAM is in the page tables
+
+    case 0xc00:
+      return cia1.read(address&15);
+
+    case 0xd00:
+      return cia2.read(address&15);
+
+    case 0xe00:
+    break;
+    case 0xf00:
+      // expansions not supported
+      //return reu.read(address&15);
       break;
   }
-  return(RAM[address]); //free RAM for user  
+  return(RAM[address]);
+}
+
+uint8_t inspect(uint16_t address)
+{
+  const uint8_t* page = read_pages[address>>8];
+  if (likely(page!=nullptr)) return page[address];
+
+  switch( address & 0xF00 )
+  {
+    case 0x000:
+    case 0x100:
+    case 0x200:
+    case 0x300:
+      return vic.inspect(address&0x3f);
+    case 0x400:
+    case 0x500:
+    case 0x600:
+    case 0x700:
+      return sid.read(address&63);
+    case 0xc00:
+      return cia1.inspect(address&15);
+    case 0xd00:
+      return cia2.inspect(address&15);
+  }
+  return(RAM[address]);
 }
 
 void poke(uint16_t address, uint8_t value)
 {
   // data breakpoint support
-  if (cpu.n_breakpoints>0)
+  if (cpu.watched(MC6502::BREAK_WRITE,address)) cpu.watch(MC6502::BREAK_WRITE,address);
+
+  uint8_t* page = write_pages[address>>8];
+  if (likely(page!=nullptr))
   {
-    Breakpoint* bp = cpu.findBreakpoint(address);
-    if (bp != nullptr)
-    {
-      monitor();
-      refreshscreen(ansi,use_ansi);
-    }
+    if (page[address] != value) cpu.idle.dirty = true;
+    page[address] = value;
+    cpu.invalidate(address);
+    return;
   }
 
-  if (unlikely((address&0xF000) == 0xD000))
+  if (address < 0x100)
   {
-    if (unlikely(mapped_io!=nullptr))
-    {
-      mapped_io[address] = value;
-    }
-    else
+    // zeropage has no page table entry for the processor port's sake
+    if (RAM[address] != value) cpu.idle.dirty = true;
+    RAM[address] = value;
+    if (unlikely(address==1))
     {
-      switch( address & 0xF00 )
-      {
-        case 0x000:
-        case 0x100:
-        case 0x200:
-        case 0x300:
-          vic.write(address&0x3f,value);
-          break;
-        case 0x500:
-        case 0x600:
-        case 0x700:
-            sid2.write(address,value);
-          break;
-        case 0x400:
-            if (address >= 0xd420)
-            sid2.write(address&31,value);
-            else
-            sid.write(address&31,value);
-          break;
-        case 0x800:
-        case 0x900:
-        case 0xa00:
-        case 0xb00:
-          CRAM[address-0xD800] = value;
-          break;
-        case 0xc00:
-          cia1.write(address&15,value);
-          break;
-        case 0xd00:
-          cia2.write(address&15,value);
-          break;
-        case 0xe00:
-          break;
-        case 0xf00:
-            //reu.write(address&15,value);
-          // expansions not yet supported
-          break;
-      }
+      processorport = value;
+      map_pages();
     }
     return;
   }
-  //if (address<RAMSIZE)
-    RAM[address] = value;
 
-    if (unlikely(address==1))
-    {
-      processorport = value;
-      int index = (value & 7);
-      mapped_basic = mappings[index][0];
-      mapped_io = mappings[index][1];
-      mapped_kernal = mappings[index][2];
-      mapped_8000 = mappings[index][3];
-    }
-    //else if (unlikely(value==0xFF00))
-    //{
-    //  reu.latch(value);
-    //}
+  cpu.idle.dirty = true;
+  switch( address & 0xF00 )
+  {
+    case 0x000:
+    case 0x100:
+    case 0x200:
+    case 0x300:
+      vic.write(address&0x3f,value);
+      break;
+    case 0x500:
+    case 0x600:
+    case 0x700:
+        sound_writes++;
+        sid2.write(address,value);
+      break;
+    case 0x400:
+        sound_writes++;
+        if (address >= 0xd420)
+        sid2.write(address&31,value);
+        else
+        sid.write(address&31,value);
+      break;
+    case 0xc00:
+      cia1.write(address&15,value);
+      break;
+    case 0xd00:
+      cia2.write(address&15,value);
+      break;
+    case 0xe00:
+      sound_writes++;
+      break;
+    case 0xf00:
+      sound_writes++;
+        //reu.write(address&15,value);
+      // expansions not yet supported
+      break;
+  }
+  //else if (unlikely(value==0xFF00))
+  //{
+  //  reu.latch(value);
+  //}
+}
+
+// rebuild the page tables from the processor port, only ever on a write to it that changes the banks
+void map_pages()
+{
+  int index = (processorport & 7);
+  if (index==mapped_index) return; // irq handlers like to store the same value again and again
+  bool first = mapped_index<0;
+  mapped_index = index;
+  // decoded RAM code of a bank that switches to ROM or I/O must not outlive the switch
+  if (mapped_basic != mappings[index][0]) cpu.invalidate(0xA000,0x2000);
+  if (mapped_kernal != mappings[index][2]) cpu.invalidate(0xE000,0x2000);
+  mapped_basic = mappings[index][0];
+  mapped_io = mappings[index][1];
+  mapped_kernal = mappings[index][2];
+  mapped_8000 = mappings[index][3];
+  cpu.code[0xA] = cpu.code[0xB] = code_mappings[index][0];
+  cpu.code[0xE] = cpu.code[0xF] = code_mappings[index][1];
+
+  // writes to ROM and to the character ROM fall through to RAM like on the real thing,
+  // only the three banks the processor port switches change after the first time
+  if (first)
+  {
+    for (int p=0; p<256; ++p) read_pages[p] = write_pages[p] = RAM;
+    write_pages[0] = nullptr;
+  }
+  for (int p=0xA0; p<0xC0; ++p) read_pages[p] = mapped_basic;
+  for (int p=0xE0; p<0x100; ++p) read_pages[p] = mapped_kernal;
+  for (int p=0xD0; p<0xE0; ++p)
+  {
+    read_pages[p] = mapped_io;
+    write_pages[p] = mapped_io ? RAM : nullptr;
+  }
+  if (mapped_io==nullptr)
+  {
+    for (int p=0xD8; p<0xDC; ++p) read_pages[p] = write_pages[p] = CRAM - 0xD800;
+  }
 }
 
 // saves some cycles in read and write to memory, pre-substraction done here
@@ -288,6 +343,17 @@ void init_mappings()
   mappings[7][1] = nullptr;
   mappings[7][2] = (uint8_t*)kernal - 0xE000;
   mappings[7][3] = &RAM[0x8000] - 0x8000;
+
+  // ROM is immutable, decode it once
+  const MC6502::Decoded* basic_code = MC6502::decode(basic,0xA000,sizeof(basic));
+  const MC6502::Decoded* kernal_code = MC6502::decode(kernal,0xE000,sizeof(kernal));
+  for (int i=0; i<8; ++i)
+  {
+    code_mappings[i][0] = (mappings[i][0] == (uint8_t*)basic - 0xA000) ? basic_code : nullptr;
+    code_mappings[i][1] = (mappings[i][2] == (uint8_t*)kernal - 0xE000) ? kernal_code : nullptr;
+  }
+  mapped_index = -1;
+  map_pages();
 }
 
 void memorymap()
@@ -320,6 +386,69 @@ void memorymap()
   delayed_bitmap = bitmap;
 }
 
+// the machine right after the first boot, later resets restore it instead of booting again.
+// the original kernal and basic only write below $0900 while booting, the RAM test puts back what it found
+#if defined(ORIGINAL_KERNAL)
+static const uint16_t BOOT_RAM = 0x0900;
+struct {
+  bool valid;
+  uint8_t ram[BOOT_RAM];
+  uint8_t cram[1024];
+  uint16_t pc;
+  uint8_t sp,a,x,y,flags;
+  uint8_t irqline,nmiline;
+  bool nmiedge;
+  VIC vic;
+  CIA1 cia1;
+  CIA2 cia2;
+} boot;
+
+void save_boot()
+{
+  memcpy(boot.ram,RAM,BOOT_RAM);
+  memcpy(boot.cram,CRAM,1024);
+  boot.pc = cpu.pc;
+  boot.sp = cpu.sp;
+  boot.a = cpu.a;
+  boot.x = cpu.x;
+  boot.y = cpu.y;
+  boot.flags = cpu.flags();
+  boot.irqline = cpu.irqline;
+  boot.nmiline = cpu.nmiline;
+  boot.nmiedge = cpu.nmiedge;
+  boot.vic = vic;
+  boot.cia1 = cia1;
+  boot.cia2 = cia2;
+  boot.valid = true;
+}
+
+void restore_boot()
+{
+  memcpy(RAM+2,boot.ram+2,BOOT_RAM-2);
+  memcpy(CRAM,boot.cram,1024);
+  uint8_t* framebuffer = vic.framebuffer;
+  uint64_t* linesig = vic.linesig;
+  vic = boot.vic;
+  vic.framebuffer = framebuffer;
+  vic.linesig = linesig;
+  cia1 = boot.cia1;
+  cia2 = boot.cia2;
+  poke(0,boot.ram[0]);
+  poke(1,boot.ram[1]); // processor port, maps the banks
+  memorymap();
+  cpu.pc = boot.pc;
+  cpu.sp = boot.sp;
+  cpu.a = boot.a;
+  cpu.x = boot.x;
+  cpu.y = boot.y;
+  cpu.setflags(boot.flags);
+  cpu.irqline = boot.irqline;
+  cpu.nmiline = boot.nmiline;
+  cpu.nmiedge = boot.nmiedge;
+  cpu.idle.dirty = true;
+}
+#endif
+
 void reset()
 {
   Storage::chdir("/",false);
@@ -338,10 +467,23 @@ void reset()
 
   // fast-forward simulate until the dot of ready appears. 
   #if defined(ORIGINAL_KERNAL)
-  RAM[1229]=' ';
-  while (RAM[1229]!='.') cpu.fastclock();
+  // a "CBM80" module signature in RAM is started by the kernal, only a real boot does that
+  static const uint8_t cbm80[] = {0xC3,0xC2,0xCD,0x38,0x30};
+  bool module = memcmp(RAM+0x8004,cbm80,sizeof(cbm80))==0;
+  if (boot.valid && !module)
+  {
+    restore_boot();
+  }
+  else
+  {
+    RAM[1229]=' ';
+    while (RAM[1229]!='.') cpu.fastclock();
+    cpu.fastrun(20000);
+    if (!module) save_boot();
+  }
+  #else
+  cpu.fastrun(20000);
   #endif
-  for (int i=0; i<20000; ++i) cpu.fastclock();
 
   refreshscreen(ansi,use_ansi);
 }
@@ -402,6 +544,7 @@ class ConfigDialog : public Dialog
   Frame f1;
   Text t1;
   Checkbox cb_ansi;
+  Checkbox cb_warp;
   Slider sl_cycle;
 public:
   ConfigDialog()
@@ -409,9 +552,10 @@ public:
   , f1(1,1,40,25)
   , t1(4,1,"OPTIONS",LIGHTBLUE)
   , cb_ansi(4,4,"ANSI")
+  , cb_warp(4,6,"WARP")
   , sl_cycle(4,8,10,-5,+5,"CYCLE ACCURRACY")
   {
-    add(&f1);add(&t1);add(&cb_ansi);add(&sl_cycle);
+    add(&f1);add(&t1);add(&cb_ansi);add(&cb_warp);add(&sl_cycle);
 
     cb_ansi.value = use_ansi;
     cb_ansi.checked = [](Checkbox*cb)
@@ -419,6 +563,12 @@ public:
       use_ansi = cb->value;
     };
 
+    cb_warp.value = warp;
+    cb_warp.checked = [](Checkbox*cb)
+    {
+      warp = cb->value;
+    };
+
     sl_cycle.value = cpu.cyclehack;
     sl_cycle.changed = [](Slider*sl)
     {
@@ -541,7 +691,7 @@ void input()
       {
         kbd.pressKey(CBM_KEY_RUNSTOP);
         cpu.nmi();  // restore
-        for (int i=0; i<1000; ++i) cpu.fastclock();
+        cpu.fastrun(1000);
         kbd.releaseKey(CBM_KEY_RUNSTOP);
       }
       return;
@@ -553,6 +703,19 @@ void input()
         use_ansi=!use_ansi;
         refreshscreen(ansi,use_ansi);
       return;// intended fall-through
+      case 23: // CTRL-W
+        warp=!warp;
+      return;
+      case 11: // CTRL-K quick save
+        Snapshot::save(QUICKSAVE,false);
+      return;
+      case 12: // CTRL-L quick load
+      {
+        File f = Storage::open(QUICKSAVE,"r",false);
+        if (Snapshot::load(f)) refreshscreen(ansi,use_ansi);
+        f.close();
+      }
+      return;
 
       case 4: // ctrl-d refresh text screen
       {
@@ -919,6 +1082,7 @@ public:
 
         file.seek(offset);
         file.read(RAM+addr,size);
+        cpu.invalidate(addr,size);
 
         //  memcpy(dest,block+skip,blocksize);
         //  size += blocksize;
@@ -1193,6 +1357,7 @@ public:
           blocksize=254;
         }
 
+        cpu.invalidate(addr,size);
         RAM[0xAF] = (addr + size) & 0xff;
         RAM[0xAE] = (addr + size) >> 8;
 
@@ -2058,10 +2223,7 @@ public:
           cpu.pc = 903;
           cpu.status |= FLAG_INTERRUPT;
           uint16_t returnaddress = 906;
-          while (cpu.pc != returnaddress)
-          {
-            cpu.fastclock();
-          }
+          cpu.fastrun(UINT32_MAX,returnaddress);
           cpu.status &=~ FLAG_INTERRUPT;
           poke(1,7);
       }
@@ -2171,11 +2333,17 @@ public:
           cpu.pc = 903;
           cpu.status |= FLAG_INTERRUPT;
           uint16_t returnaddress = 906;
+          if (cpu.n_breakpoints==0 && cpu.n_watchpoints==0)
+          {
+            cpu.fastrun(UINT32_MAX,returnaddress);
+          }
+          cpu.stopped = nullptr;
           while (cpu.pc != returnaddress)
           {
             cpu.fastclock();
-            if (cpu.hitsBreakpoint())
+            if (cpu.stopped || cpu.hitsBreakpoint())
             {
+              cpu.stopped = nullptr;
               monitor();
             }
           }
@@ -2266,6 +2434,7 @@ public:
     size = file.size() - offset;
     file.read(&RAM[header.loadAddr],size);
     file.close();
+    cpu.invalidate(header.loadAddr,size);
 
     Assembler as;
     as.define("init",MC6502::swap(header.initAddr));
@@ -2355,9 +2524,33 @@ void hijacked_load(const char* label)
     {
       sid.setChipType('8');
     }
+    if (0==strcmp(str,"WARP"))
+    {
+      warp = !warp;
+    }
 
     cpu.y = 0x49;    // "LOADING"
     cpu.pc = KERNAL_PRINT_MESSAGE; // Check direct mode, print and return with carry cleared
+
+    // the snapshot resumes right here, as if the command had just finished
+    if (0==strcmp(str,"SNAP"))
+    {
+      Snapshot::save("/snapshot.b64",ZP_DEVNO==8);
+    }
+    if (0==strcmp(str,"RESUME"))
+    {
+      resume_pending = true;
+      resume_sd = ZP_DEVNO==8;
+    }
+    // a number after the format keeps only every Nth frame
+    bool y4m = 0==strncmp(str,"Y4M",3);
+    if (y4m || 0==strncmp(str,"PPM",3))
+    {
+      if (framedump.active())
+        framedump.stop();
+      else
+        framedump.start(Storage::open(y4m ? "/frames.y4m" : "/frames.ppm","w",ZP_DEVNO==8),y4m ? FrameDump::Y4M : FrameDump::PPM,atoi(str+3));
+    }
     return;
   }
 
@@ -2550,6 +2743,7 @@ void hijacked_load(const char* label)
       }
       globalfile.read(&RAM[addr], size);
       globalfile.close();
+      cpu.invalidate(addr,size);
 
       RAM[0xAE] = (addr + size) & 0xff;
       RAM[0xAF] = (addr + size) >> 8;
@@ -2773,7 +2967,7 @@ void hijacked_chkin(const char* label)
 
   cpu.a = devno;
   ZP_CURINPUTDEVICE = devno;
-  cpu.status &= FLAG_CARRY;
+  cpu.setflags(cpu.flags() & FLAG_CARRY);
   cpu.pc = 0xF233;
 }
 
@@ -2996,10 +3190,12 @@ void http_prg_upload(AsyncWebServerRequest *request, const String& filename, siz
   {
     addr = data[1]*256 + data[0];
     memcpy(&RAM[addr],data+2,len-2);
+    cpu.invalidate(addr,len-2);
   }
   else
   {
     memcpy(&RAM[addr+index-2],data,len);
+    cpu.invalidate(addr+index-2,len);
   }
 
   if (final)
@@ -3080,6 +3276,9 @@ void setup()
 
   Serial.println("[CPU]...");
   cpu.init();
+#if defined(CPU_BLOCK_CACHE)
+  cpu.blocks.exclude(0xD0,0xDF); // I/O, character ROM or RAM depending on the processor port
+#endif
   cpu.setpatch(0xf49e,hijacked_load,"LOAD");
   cpu.setpatch(0xF34A,hijacked_open,"OPEN");
   cpu.setpatch(0xf5dd,hijacked_save,"SAVE");
@@ -3104,66 +3303,145 @@ void setup()
   pathname.changeDir();
 
   last_timestamp = micros();
-  delta_accumulator = 0;
+  next_frame = last_timestamp;
 }
 
-void loop()
+void run_frame()
 {
-  unsigned long now = micros();
-  long delta = now-last_timestamp;
-  last_timestamp = now;
-
-  accurracy += delta;
-
-  delta_accumulator += delta;
-  // 20000µs = 20ms = 1000ms / 50fps = PAL
-  if (delta_accumulator < 20000) return;
-  delta_accumulator = 0;
-
   cia1.prefetch();
   cia2.prefetch();
   for (uint32_t y=0; y<RASTERLINES_PER_FRAME; ++y)
   {
     vic.begin(y);
-    for (vic.cycle=1; vic.cycle<=CYCLES_PER_RASTERLINE;++vic.cycle)
+    vic.cycle=1;
+    while (vic.cycle<=CYCLES_PER_RASTERLINE)
     {
       vic.clock(); // just check for irq
       cia1.clock();
       cia2.clock();
       sid.clock();
       //reu.clock();
-      if (vic.cpu_is_rdy)
+
+      // the cpu runs whole instructions up to the next cycle a chip has something to do
+      uint32_t end = vic.nextEvent();
+      Chip* chips[] = { &cia1, &cia2, &sid };
+      for (Chip* chip : chips)
       {
-        cpu.clock();
-        if (cpu.hitsBreakpoint())
+        uint32_t next = chip->nextEvent();
+        if (next<end-vic.cycle) end = vic.cycle+next;
+      }
+
+      uint32_t usable = vic.usable(end);
+      if (usable)
+      {
+        cia1.follow(cpu_overshoot);
+        cia2.follow(cpu_overshoot);
+        cpu_overshoot = cpu.run(usable-cpu_overshoot);
+        end -= cpu.cut; // a timer irq armed on the way
+        if (cpu.stopped)
         {
           monitor();
           refreshscreen(ansi,use_ansi);
         }
       }
+
+      // and the chips catch up with the cycles in between
+      for (Chip* chip : chips) chip->advance(end-vic.cycle-1);
+      vic.cycle = end;
     }
+    vic.end();
   }
-  input();
+}
 
-  if (!use_ansi)
+void loop()
+{
+  unsigned long now = micros();
+  long delta = now-last_timestamp;
+  last_timestamp = now;
+
+  accurracy += delta;
+
+  // 20000µs = 20ms = 1000ms / 50fps = PAL
+  int frames = (quiet_frames>=IDLE_AFTER) ? IDLE_BATCH : 1;
+  // a batch waits for the due time of its last frame
+  long remaining = (long)(next_frame + 20000*(frames-1) - now);
+  if (remaining > 0 && !warp)
   {
-    ansi->sync(delayed_matrix,CRAM,vic.read(0x21));
+    // sleep instead of spinning, delay() hands the core to other tasks and only the last millisecond is polled
+    if (remaining>=2000) delay(remaining/1000-1);
+    return;
+  }
+  if (warp)
+  {
+    frames = 1;
+    next_frame = now;
+  }
+  else
+  {
+    long late = -remaining;
+    jitter_sum += late;
+    jitter_count++;
+    if (late>jitter_max) jitter_max = late;
+    next_frame += 20000*frames;
+    // far behind (the monitor, a slow file), start over from now instead of racing to catch up
+    if ((long)(now - next_frame) > 20000*IDLE_BATCH) next_frame = now;
+  }
+
+  bool typing = Serial.available()>0 || !kbd.queue.empty();
+  for (int i=0; i<frames; ++i)
+  {
+    run_frame();
+    framedump.frame();
+    input();
+    if (resume_pending)
+    {
+      resume_pending = false;
+      File f = Storage::open("/snapshot.b64","r",resume_sd);
+      if (Snapshot::load(f)) refreshscreen(ansi,use_ansi);
+      f.close();
+    }
   }
 
-  frame++;
+  int changes = 0;
+  if (!use_ansi && (!warp || now-last_sync >= WARP_SYNC_INTERVAL))
+  {
+    changes = ansi->sync(delayed_matrix,CRAM,vic.read(0x21));
+    last_sync = now;
+  }
+  // a blinking cursor alone doesn't count as a change
+  if (typing || sound_writes || changes>1 || (changes==1 && ZP_CURSORVISIBILITY!=0)) quiet_frames = 0;
+  else quiet_frames += frames;
+  sound_writes = 0;
+
+  frame += frames;
   if (frame>=50)
   {
     //ArduinoOTA.handle();
-    float percentage = (20.0f/(accurracy/50.0f/1000.0f))*100.0f;
-    Serial.printf("\e]0; %s %s %.1f%% r:%d io/s w:%d io/s \007",use_ansi?"ANSI":"POLL",
+    float percentage = (20.0f/(accurracy/(float)frame/1000.0f))*100.0f;
+    Serial.printf("\e]0; %s%s %s %.1f%% r:%d io/s w:%d io/s idle:%.1f%% jitter:%ld/%ldus "
+    #if defined(CPU_BLOCK_CACHE)
+      "blocks:%.1f%% "
+    #endif
+      "\007",use_ansi?"ANSI":"POLL",warp?" WARP":"",
     #if defined(USEWIFI)
     WiFi.localIP().toString().c_str(),
     #else
       "disabled",
     #endif
-    percentage,io.reads,io.writes    );
+    percentage,io.reads,io.writes,100.0f*cpu.idlecycles/((float)frame*CYCLES_PER_RASTERLINE*RASTERLINES_PER_FRAME),
+    jitter_count ? jitter_sum/jitter_count : 0,jitter_max
+    #if defined(CPU_BLOCK_CACHE)
+    ,(cpu.blocks.hits+cpu.blocks.misses) ? 100.0f*cpu.blocks.hits/(cpu.blocks.hits+cpu.blocks.misses) : 0.0f
+    #endif
+    );
     io.reads = io.writes = 0;
+    cpu.idlecycles = 0;
+    #if defined(CPU_BLOCK_CACHE)
+    cpu.blocks.hits = cpu.blocks.misses = 0;
+    #endif
     accurracy = 0;
+    jitter_sum = jitter_max = 0;
+    jitter_count = 0;
     frame=0;
   }
 
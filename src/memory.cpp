@@ -42,6 +42,8 @@ uint8_t* mapped_8000 = 0;
 uint8_t* mapped_kernal = 0;
 uint8_t* mapped_basic = 0;
 uint8_t* mapped_io = 0;
+uint8_t* read_pages[256];
+uint8_t* write_pages[256];
 uint8_t* vic_bitmap = 0;
 uint8_t* vic_matrix = 0;
 uint8_t* vic_chargen = 0;
@@ -56,6 +56,11 @@ extern uint8_t* mapped_basic;
 extern uint8_t* mapped_io;
 extern uint8_t* mapped_8000;
 
+// the cpu's view of memory, one base pointer per 256 byte page with the page address pre-substracted like mapped_*
+// nullptr sends the access to the I/O handlers of peek() and poke()
+extern uint8_t* read_pages[256];
+extern uint8_t* write_pages[256];
+
 extern uint8_t* vic_bitmap;
 extern uint8_t* vic_matrix;
 extern uint8_t* vic_chargen;
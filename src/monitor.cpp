@@ -255,8 +255,12 @@ void Hexview::output(TextMatrix* tm)
         tm->printf("%04X:",addr);
         for (int col=0; col<columns; ++col)
         {
-            tm->printf("%02X ",peek(addr+col));
+            uint16_t a = addr+col;
+            bool watched = cpu.findBreakpoint(a,Breakpoint::READ) || cpu.findBreakpoint(a,Breakpoint::WRITE);
+            tm->setColor(watched ? RED : WHITE);
+            tm->printf("%02X ",peek(a));
         }
+        tm->setColor(WHITE);
         for (int col=0; col<columns; ++col)
         {
             uint8_t cc = peek(addr+col);
@@ -375,22 +379,23 @@ public:
         tm->setColor(cpu.sp!=cpu.last.sp?RED:GRAY2);
         tm->printf("%02X ",cpu.sp);
 
-        tm->setColor(((cpu.status&FLAG_CARRY)!=(cpu.last.status&FLAG_CARRY))?RED:GRAY2);
-        tm->print((cpu.status&FLAG_CARRY)?"C":"-");
-        tm->setColor(((cpu.status&FLAG_ZERO)!=(cpu.last.status&FLAG_ZERO))?RED:GRAY2);
-        tm->print((cpu.status&FLAG_ZERO)?"Z":"-");
-        tm->setColor(((cpu.status&FLAG_INTERRUPT)!=(cpu.last.status&FLAG_INTERRUPT))?RED:GRAY2);
-        tm->print((cpu.status&FLAG_INTERRUPT)?"I":"-");
-        tm->setColor(((cpu.status&FLAG_DECIMAL)!=(cpu.last.status&FLAG_DECIMAL))?RED:GRAY2);
-        tm->print((cpu.status&FLAG_DECIMAL)?"D":"-");
-        tm->setColor(((cpu.status&FLAG_BREAK)!=(cpu.last.status&FLAG_BREAK))?RED:GRAY2);
-        tm->print((cpu.status&FLAG_BREAK)?"B":"-");
+        uint8_t status = cpu.flags();
+        tm->setColor(((status&FLAG_CARRY)!=(cpu.last.status&FLAG_CARRY))?RED:GRAY2);
+        tm->print((status&FLAG_CARRY)?"C":"-");
+        tm->setColor(((status&FLAG_ZERO)!=(cpu.last.status&FLAG_ZERO))?RED:GRAY2);
+        tm->print((status&FLAG_ZERO)?"Z":"-");
+        tm->setColor(((status&FLAG_INTERRUPT)!=(cpu.last.status&FLAG_INTERRUPT))?RED:GRAY2);
+        tm->print((status&FLAG_INTERRUPT)?"I":"-");
+        tm->setColor(((status&FLAG_DECIMAL)!=(cpu.last.status&FLAG_DECIMAL))?RED:GRAY2);
+        tm->print((status&FLAG_DECIMAL)?"D":"-");
+        tm->setColor(((status&FLAG_BREAK)!=(cpu.last.status&FLAG_BREAK))?RED:GRAY2);
+        tm->print((status&FLAG_BREAK)?"B":"-");
         tm->setColor(GRAY2);
         tm->print("1");
-        tm->setColor(((cpu.status&FLAG_OVERFLOW)!=(cpu.last.status&FLAG_OVERFLOW))?RED:GRAY2);
-        tm->print((cpu.status&FLAG_OVERFLOW)?"O":"-");
-        tm->setColor(((cpu.status&FLAG_SIGN)!=(cpu.last.status&FLAG_SIGN))?RED:GRAY2);
-        tm->print((cpu.status&FLAG_SIGN)?"S":"-");
+        tm->setColor(((status&FLAG_OVERFLOW)!=(cpu.last.status&FLAG_OVERFLOW))?RED:GRAY2);
+        tm->print((status&FLAG_OVERFLOW)?"O":"-");
+        tm->setColor(((status&FLAG_SIGN)!=(cpu.last.status&FLAG_SIGN))?RED:GRAY2);
+        tm->print((status&FLAG_SIGN)?"S":"-");
 
     }
 };
@@ -442,6 +447,112 @@ public:
 
 };
 
+class ConditionDialog : public Dialog
+{
+public:
+    Frame frame,f2;
+    Text text,text2;
+    Button cancel;
+    TextEdit edit;
+    Condition condition;
+    ConditionDialog()
+    : frame(2,7,36,10)
+    , f2(3,9,34,3)
+    , text(2+3,7,"BREAK IF")
+    , text2(4,12,"A>=$80 && peek($D012)==$30")
+    , cancel(28,13,8,3, "CANCEL")
+    , edit(4,10,32)
+    {
+        add(&frame);
+        add(&f2);
+        add(&text);
+        add(&edit);
+        add(&cancel);
+        add(&text2);
+        edit.setFocus();
+
+        edit.accepted = [&](const std::string&v){
+            if (condition.compile(v.c_str()))
+            {
+                result = Result::OK;
+                return;
+            }
+            text2.text = "SYNTAX ERROR AT ";
+            text2.text += v.substr(condition.error,16).c_str();
+            edit.cursor = condition.error;
+        };
+
+        cancel.clicked = [&](Widget*) {
+            result = Result::CANCEL;
+        };
+    }
+
+    virtual int input()
+    {
+        int c = Dialog::input();
+        if (c==27)
+        {
+            result = Result::CANCEL;
+            return c;
+        }
+        return -1;
+    }
+
+};
+
+// every breakpoint and watchpoint, X executes, R reads, W writes
+class BreakpointList : public Widget
+{
+public:
+    BreakpointList(uint8_t _x, uint8_t _y, uint8_t _w, uint8_t _h) : Widget(_x,_y,_w,_h) {}
+    virtual void output(TextMatrix* tm)
+    {
+        for (int row=0; row<height; ++row)
+        {
+            tm->setCursor(x,y+row);
+            tm->setColor(GRAY2);
+            if (row>=(int)cpu.breakpoints.size())
+            {
+                tm->printf("%-*s",width,"");
+                continue;
+            }
+            const Breakpoint& bp = cpu.breakpoints[row];
+            char kind = (bp.flags & Breakpoint::READ) ? 'R' : (bp.flags & Breakpoint::WRITE) ? 'W' : 'X';
+            if (bp.flags & Breakpoint::ENABLE) tm->setColor(RED);
+            tm->printf("%c $%04X %-3s %-4s HITS %-10u",kind,bp.pc,(bp.flags & Breakpoint::ENABLE) ? "ON" : "OFF",
+                (bp.flags & Breakpoint::EXPRESSION) ? "IF" : "",bp.hits);
+        }
+    }
+};
+
+class BreakpointsDialog : public Dialog
+{
+public:
+    Frame frame;
+    Text text;
+    BreakpointList list;
+    BreakpointsDialog()
+    : frame(2,3,36,20)
+    , text(2+3,3,"BREAKPOINTS")
+    , list(4,5,32,16)
+    {
+        add(&frame);
+        add(&text);
+        add(&list);
+    }
+
+    virtual int input()
+    {
+        int c = Dialog::input();
+        if (c==27)
+        {
+            result = Result::CANCEL;
+            return c;
+        }
+        return -1;
+    }
+};
+
 class JumpToDialog : public Dialog
 {
 public:
@@ -1285,6 +1396,32 @@ public:
       };
     }
 
+    // the address under the cursor of the view that is shown
+    uint16_t cursor() const
+    {
+        return hexview.enabled ? hexview.base : disass.base;
+    }
+
+    void toggle(uint16_t addr, uint8_t kind)
+    {
+        if (cpu.findBreakpoint(addr,kind)) cpu.removeBreakpoint(addr,kind);
+        else cpu.addBreakpoint(addr,Breakpoint::ENABLE|kind);
+    }
+
+    // after a step, tells when a watchpoint caught one of its accesses
+    void stepped()
+    {
+        disass.base = cpu.pc;
+        hexview.base = cpu.pc;
+        text.text = "Balstermon";
+        if (cpu.stopped && (cpu.stopped->flags & (Breakpoint::READ|Breakpoint::WRITE)))
+        {
+            char line[24];
+            sprintf(line,"Balstermon %s $%04X",(cpu.stopped->flags & Breakpoint::READ) ? "READ" : "WRITE",cpu.stopped->pc);
+            text.text = line;
+        }
+    }
+
     virtual int input()
     {
         int c = Dialog::input();
@@ -1303,8 +1440,8 @@ public:
 
             case VK_F9:
             {
-                //BreakpointsDialog dlg;
-                //dlg.run(this,matrix,ansi);
+                BreakpointsDialog dlg;
+                dlg.run(this,matrix,ansi);
             }
             break;
 
@@ -1336,25 +1473,16 @@ public:
             break;
 
             case VK_F11:
-            {
                 cpu.stepIn();
-                disass.base = cpu.pc;
-                hexview.base = cpu.pc;
-            }
+                stepped();
             break;
             case 'o':
-            {
                 cpu.stepOut();
-                disass.base = cpu.pc;
-                hexview.base = cpu.pc;
-            }
+                stepped();
             break;
             case VK_F10:
-            {
                 cpu.stepOver();
-                disass.base = cpu.pc;
-                hexview.base = cpu.pc;
-            }
+                stepped();
             break;
             case 'i':
             {
@@ -1364,10 +1492,31 @@ public:
             }
             break;
             case '+':
-                cpu.addBreakpoint(disass.base);
+                // on data in the hex view it catches the writes, as it always did
+                if (hexview.enabled) cpu.addBreakpoint(hexview.base,Breakpoint::ENABLE|Breakpoint::WRITE);
+                else cpu.addBreakpoint(disass.base);
                 break;
             case '-':
-                cpu.removeBreakpoint(disass.base);
+                cpu.removeBreakpoint(cursor());
+                cpu.removeBreakpoint(cursor(),Breakpoint::READ);
+                cpu.removeBreakpoint(cursor(),Breakpoint::WRITE);
+                break;
+            case 'r':
+                toggle(cursor(),Breakpoint::READ);
+                break;
+            case 'w':
+                toggle(cursor(),Breakpoint::WRITE);
+                break;
+            case 'c':
+                {
+                    ConditionDialog dlg;
+                    dlg.run(this,matrix,ansi);
+                    if (dlg.result == OK)
+                    {
+                        cpu.addBreakpoint(disass.base, dlg.condition);
+                    }
+                    return true;
+                }
                 break;
 
             case 'g':
@@ -1421,6 +1570,7 @@ void monitor_init()
 
 void monitor()
 {
-    
+    cpu.paused = 1;
     DisassemblerDialog().run(nullptr,g_matrix,g_ansi);
+    cpu.paused = 0;
 }
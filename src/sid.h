@@ -70,6 +70,7 @@ public:
     void setNTSC();
     virtual void setup();
     virtual void clock();
+    virtual void advance(uint32_t n) {} // the real chip has its own clock
     virtual void reset();
     virtual uint8_t read(uint8_t adr);
     virtual void write(uint8_t adr, uint8_t val);
@@ -0,0 +1,297 @@
+/*
+ * Balster64, hacking a C64 emulator into an ESP32 microcontroller
+ *
+ * Copyright (C) Daniel Balster
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Daniel Balster nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY DANIEL BALSTER ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL DANIEL BALSTER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "snapshot.h"
+#include "cpu.h"
+#include "vic.h"
+#include "cia.h"
+#include "sid.h"
+#include "memory.h"
+#include "storage.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char MAGIC[4] = {'B','6','4','S'};
+
+// little endian on every platform, each put tells whether the bytes made it into the file
+static bool put(fs::File& f, const uint8_t* data, uint32_t size) { return f.write(data,size)==size; }
+static bool put8(fs::File& f, uint8_t v) { return f.write(v)==1; }
+static bool put16(fs::File& f, uint16_t v) { return put8(f,v) && put8(f,v>>8); }
+static bool put32(fs::File& f, uint32_t v) { return put16(f,v) && put16(f,v>>16); }
+static bool tag(fs::File& f, const char* name) { return put(f,(const uint8_t*)name,4); }
+
+// reads front to back and remembers the first short read, the values are only used when ok stayed true
+struct Reader
+{
+  fs::File& f;
+  bool ok;
+  Reader(fs::File& _f) : f(_f), ok(true) {}
+
+  uint8_t get8() { int c = f.read(); if (c<0) ok = false; return c; }
+  uint16_t get16() { uint16_t v = get8(); return v | (get8()<<8); }
+  uint32_t get32() { uint32_t v = get16(); return v | ((uint32_t)get16()<<16); }
+  void get(uint8_t* data, uint32_t size) { if (f.read(data,size)!=size) ok = false; }
+  void expect(const char* name)
+  {
+    uint8_t buf[4] = {0};
+    get(buf,4);
+    if (memcmp(buf,name,4)!=0) ok = false;
+  }
+};
+
+// packbits: n<128 is followed by n+1 literal bytes, n>128 repeats the next byte 257-n times
+static bool pack(fs::File& f, const uint8_t* data, uint32_t size)
+{
+  uint32_t i = 0;
+  while (i<size)
+  {
+    uint32_t run = 1;
+    while (i+run<size && run<128 && data[i+run]==data[i]) run++;
+    if (run>1)
+    {
+      if (!put8(f,257-run) || !put8(f,data[i])) return false;
+      i += run;
+      continue;
+    }
+    // literals up to the next run of at least two
+    uint32_t n = 1;
+    while (i+n<size && n<128 && !(i+n+1<size && data[i+n]==data[i+n+1])) n++;
+    if (!put8(f,n-1) || !put(f,data+i,n)) return false;
+    i += n;
+  }
+  return true;
+}
+
+static void unpack(Reader& r, uint8_t* data, uint32_t size)
+{
+  uint32_t i = 0;
+  while (i<size && r.ok)
+  {
+    uint8_t c = r.get8();
+    if (!r.ok || c==128) { r.ok = false; return; }
+    uint32_t n = c<128 ? c+1 : 257-c;
+    if (i+n>size) { r.ok = false; return; }
+    if (c<128) r.get(data+i,n);
+    else memset(data+i,r.get8(),n);
+    i += n;
+  }
+}
+
+static bool block(fs::File& f, const uint8_t* data, uint32_t size, bool rle)
+{
+  return rle ? pack(f,data,size) : put(f,data,size);
+}
+
+static void unblock(Reader& r, uint8_t* data, uint32_t size, bool rle)
+{
+  if (rle) unpack(r,data,size); else r.get(data,size);
+}
+
+// chip state as it sits in the file, decoded completely before any of it is applied
+struct CIAState
+{
+  uint8_t pra, prb, ddra, ddrb, cra, crb, icr, imr;
+  uint16_t counterA, counterB, latchA, latchB;
+};
+
+struct SIDState
+{
+  uint8_t model;
+  uint8_t regs[0x19];
+};
+
+static bool save_cia(fs::File& f, CIA& cia)
+{
+  cia.update();
+  return put8(f,cia.pra) && put8(f,cia.prb) && put8(f,cia.ddra) && put8(f,cia.ddrb)
+      && put8(f,cia.cra) && put8(f,cia.crb) && put8(f,cia.icr) && put8(f,cia.imr)
+      && put16(f,cia.counterA) && put16(f,cia.counterB)
+      && put16(f,cia.latchA) && put16(f,cia.latchB);
+}
+
+static void read_cia(Reader& r, CIAState& s)
+{
+  s.pra = r.get8(); s.prb = r.get8(); s.ddra = r.get8(); s.ddrb = r.get8();
+  s.cra = r.get8(); s.crb = r.get8(); s.icr = r.get8(); s.imr = r.get8();
+  s.counterA = r.get16(); s.counterB = r.get16();
+  s.latchA = r.get16(); s.latchB = r.get16();
+}
+
+static void load_cia(const CIAState& s, CIA& cia)
+{
+  cia.pra = s.pra; cia.prb = s.prb; cia.ddra = s.ddra; cia.ddrb = s.ddrb;
+  cia.cra = s.cra; cia.crb = s.crb; cia.icr = s.icr; cia.imr = s.imr;
+  cia.counterA = s.counterA; cia.counterB = s.counterB;
+  cia.latchA = s.latchA; cia.latchB = s.latchB;
+  cia.stamp = cia.now();
+  cia.schedule();
+  cia.interrupt();
+}
+
+static bool save_sid(fs::File& f, HardSID& s)
+{
+  return put8(f,s.model) && put(f,s.regs,0x19);
+}
+
+static void read_sid(Reader& r, SIDState& s)
+{
+  s.model = r.get8();
+  r.get(s.regs,sizeof(s.regs));
+}
+
+static void load_sid(const SIDState& s, HardSID& sid)
+{
+  if (s.model=='6' || s.model=='8') sid.setChipType(s.model);
+  for (int i=0; i<0x19; ++i) sid.write(i,s.regs[i]);
+}
+
+bool Snapshot::save(fs::File& f, bool rle)
+{
+  if (!f) return false;
+  bool ok = tag(f,MAGIC) && put8(f,VERSION) && put8(f,rle ? FLAG_RLE : 0);
+
+  ok = ok && tag(f,"CPU ")
+     && put16(f,cpu.pc)
+     && put8(f,cpu.sp) && put8(f,cpu.a) && put8(f,cpu.x) && put8(f,cpu.y) && put8(f,cpu.flags())
+     && put8(f,cpu.irqline) && put8(f,cpu.nmiline) && put8(f,cpu.nmiedge)
+     && put8(f,(int8_t)cpu.cyclehack)
+     && put32(f,cpu.clockcycles);
+
+  ok = ok && tag(f,"MEM ")
+     && block(f,RAM,0x10000,rle)
+     && block(f,CRAM,1024,rle);
+
+  ok = ok && tag(f,"VIC ")
+     && put(f,vic.regs,sizeof(vic.regs))
+     && put8(f,vic.irr)
+     && put16(f,vic.rasterline)
+     && put8(f,vic.DENwasSetInRasterline30);
+
+  ok = ok && tag(f,"CIA1") && save_cia(f,cia1)
+     && tag(f,"CIA2") && save_cia(f,cia2)
+     && tag(f,"SID1") && save_sid(f,sid)
+     && tag(f,"SID2") && save_sid(f,sid2);
+  return ok;
+}
+
+bool Snapshot::save(const char* path, bool sd, bool rle)
+{
+  fs::File f = Storage::open(path,"w",sd);
+  bool ok = save(f,rle);
+  f.close();
+  if (!ok) Storage::remove(path,sd); // a cut off snapshot would only be refused by load()
+  return ok;
+}
+
+bool Snapshot::load(fs::File& f)
+{
+  if (!f) return false;
+  Reader r(f);
+  r.expect(MAGIC);
+  if (!r.ok || r.get8()!=VERSION) return false;
+  bool rle = r.get8() & FLAG_RLE;
+
+  r.expect("CPU ");
+  uint16_t pc = r.get16();
+  uint8_t sp = r.get8(), a = r.get8(), x = r.get8(), y = r.get8(), flags = r.get8();
+  uint8_t irqline = r.get8(), nmiline = r.get8(), nmiedge = r.get8();
+  int8_t cyclehack = r.get8();
+  uint32_t clockcycles = r.get32();
+  if (!r.ok) return false;
+
+  // memory goes to scratch as well, a file cut off in the middle of MEM must not leave half a RAM behind
+  uint8_t* ram = (uint8_t*)malloc(0x10000+1024);
+  if (ram==nullptr) return false;
+  uint8_t* cram = ram+0x10000;
+  r.expect("MEM ");
+  unblock(r,ram,0x10000,rle);
+  unblock(r,cram,1024,rle);
+
+  r.expect("VIC ");
+  uint8_t regs[sizeof(vic.regs)] = {0};
+  r.get(regs,sizeof(regs));
+  uint8_t irr = r.get8();
+  uint16_t rasterline = r.get16();
+  bool den30 = r.get8();
+
+  CIAState state1, state2;
+  SIDState voice1, voice2;
+  r.expect("CIA1"); read_cia(r,state1);
+  r.expect("CIA2"); read_cia(r,state2);
+  r.expect("SID1"); read_sid(r,voice1);
+  r.expect("SID2"); read_sid(r,voice2);
+  if (!r.ok)
+  {
+    free(ram);
+    return false;
+  }
+
+  // everything decoded, from here on the machine is replaced as a whole
+  memcpy(RAM,ram,0x10000);
+  memcpy(CRAM,cram,1024);
+  free(ram);
+  poke(0,RAM[0]);
+  poke(1,RAM[1]); // processor port, maps the banks
+  cpu.invalidate(0,0x10000);
+
+  cpu.pc = pc;
+  cpu.sp = sp; cpu.a = a; cpu.x = x; cpu.y = y;
+  cpu.setflags(flags);
+  cpu.cyclehack = cyclehack;
+  // the cias may be following the cpu through its clockcycles, their time goes on without a jump
+  cia1.origin += clockcycles-cpu.clockcycles;
+  cia2.origin += clockcycles-cpu.clockcycles;
+  cpu.clockcycles = clockcycles;
+  cpu.idle.dirty = true;
+
+  vic.reset();
+  for (int i=0; i<=0x2e; ++i)
+  {
+    if (i==0x19 || i==0x1e || i==0x1f) continue; // irq acknowledge, collisions only latch
+    vic.write(i,regs[i]);
+  }
+  vic.regs[0x1e] = regs[0x1e];
+  vic.regs[0x1f] = regs[0x1f];
+  vic.irr = irr;
+  vic.rasterline = rasterline;
+  vic.DENwasSetInRasterline30 = den30;
+  vic.interrupt();
+
+  load_cia(state1,cia1);
+  load_cia(state2,cia2);
+  memorymap(); // vic bank from cia2
+
+  load_sid(voice1,sid);
+  load_sid(voice2,sid2);
+
+  cpu.irqline = irqline;
+  cpu.nmiline = nmiline;
+  cpu.nmiedge = nmiedge;
+  return true;
+}
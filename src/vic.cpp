@@ -36,6 +36,67 @@
 
 VIC vic;
 
+// a byte of graphics expanded to 8 pixel masks of 0x00/0xFF, leftmost pixel in the lowest address
+static uint64_t hires_mask[256];
+static uint64_t multi_lo[256]; // pixel pairs with the low bit set
+static uint64_t multi_hi[256]; // pixel pairs with the high bit set
+static uint16_t stretch_bits[256]; // every bit doubled for x expanded sprites
+
+// a rasterline as bits, pixel 64*w in bit 63 of word w, wide enough for sprites right of the screen
+static const int LINE_WORDS = 10;
+
+static inline uint64_t splat(uint8_t color)
+{
+  return color * 0x0101010101010101ULL;
+}
+
+static inline void put8(uint8_t* p, uint64_t pixels)
+{
+  memcpy(p,&pixels,8);
+}
+
+static inline uint64_t hires(uint8_t bits, uint8_t fg, uint8_t bg)
+{
+  uint64_t m = hires_mask[bits];
+  return (splat(fg) & m) | (splat(bg) & ~m);
+}
+
+// the 24 or 48 sprite pixels of a line, left aligned
+static inline uint64_t stretch(uint32_t bits, bool expand)
+{
+  if (!expand) return (uint64_t)bits << 40;
+  return ((uint64_t)stretch_bits[(bits>>16) & 0xFF] << 48) | ((uint64_t)stretch_bits[(bits>>8) & 0xFF] << 32) | ((uint64_t)stretch_bits[bits & 0xFF] << 16);
+}
+
+// color the pixels of one line word that have their bit set
+static inline void paint(uint8_t* row, int w, uint64_t bits, uint8_t color)
+{
+  if (bits == 0 || w >= SCREEN_WIDTH/64) return;
+  uint8_t* p = row + w*64;
+  for (int shift=56; shift>=0; shift-=8, p+=8)
+  {
+    uint8_t b = bits >> shift;
+    if (b == 0) continue;
+    uint64_t m = hires_mask[b], pixels;
+    memcpy(&pixels,p,8);
+    put8(p,(pixels & ~m) | (splat(color) & m));
+  }
+}
+
+static inline uint64_t mix(uint64_t h, uint64_t w)
+{
+  h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+  return h ^ (h >> 32);
+}
+
+static inline uint64_t multi(uint8_t bits, uint8_t c0, uint8_t c1, uint8_t c2, uint8_t c3)
+{
+  uint64_t lo = multi_lo[bits];
+  uint64_t a = splat(c0) ^ (lo & splat(c0^c1));
+  uint64_t b = splat(c2) ^ (lo & splat(c2^c3));
+  return a ^ (multi_hi[bits] & (a^b));
+}
+
 uint8_t VIC::read(uint8_t adr)
 {
     switch(adr)
@@ -93,7 +154,7 @@ uint8_t VIC::read(uint8_t adr)
       case 0x1e: // spr spr collision
         {
           uint8_t v = regs[adr];
-          regs[0x1e] = 0;
+          regs[adr] = 0;
           return v;
         }
       case 0x20:
@@ -186,13 +247,11 @@ uint8_t VIC::read(uint8_t adr)
       return;
       case 0x11:
         current.yctrl = delayed.yctrl = value;
+        if (cycle<17) plan(); // still in time for this line's badline check
         if (unlikely(rasterline == rasterline_irq && rasterline != 0))
         {
           irr |= 1;
-          if (irr & imr)
-          {
-            cpu.irq();
-          }
+          interrupt();
         }
         memorymap();
         return;
@@ -215,9 +274,11 @@ uint8_t VIC::read(uint8_t adr)
       return;
       case 0x19:
         irr &= (~value) & 0x0F;
+        interrupt();
         return;
       case 0x1a:
         imr = value & 0x0F;
+        interrupt();
         return;
       case 0x1c:
         d01c = value;
@@ -230,10 +291,7 @@ uint8_t VIC::read(uint8_t adr)
           if (unlikely(rasterline == rasterline_irq))
           {
             irr |= 1;
-            if (irr & imr)
-            {
-              cpu.irq();
-            }
+            interrupt();
           }
 
           //if (rasterline == rasterline_irq)
@@ -265,56 +323,197 @@ uint8_t VIC::read(uint8_t adr)
 
 void VIC::draw_text_multicolor()
 {
-
+  uint8_t bits = delayed_chargen[line[vc]*8+rc];
+  uint8_t color = cram[vc] & 0x0F;
+  if (color & 8)
+    put8(pout,multi(bits,colors[BG0],colors[BG1],colors[BG2],color & 7));
+  else
+    put8(pout,hires(bits,color,colors[BG0]));
 }
 
 void VIC::draw_bitmap_multicolor()
 {
-
+  uint8_t c = line[vc];
+  put8(pout,multi(delayed_bitmap[vc*8+rc],colors[BG0],c>>4,c & 0x0F,cram[vc] & 0x0F));
 }
 
 void VIC::draw_border_color()
 {
-
+  put8(pout,splat(colors[BORDER]));
 }
 
 void VIC::draw_void()
 {
-
+  put8(pout,0); // invalid modes show black
 }
 
 void VIC::draw_bitmap_mono()
 {
-
+  uint8_t c = line[vc];
+  put8(pout,hires(delayed_bitmap[vc*8+rc],c>>4,c & 0x0F));
 }
 
 void VIC::draw_text_ecm()
 {
-
+  uint8_t c = line[vc];
+  put8(pout,hires(delayed_chargen[(c & 0x3F)*8+rc],cram[vc] & 0x0F,colors[BG0+(c>>6)]));
 }
 
 void VIC::draw_text_mono()
 {
-
+  put8(pout,hires(delayed_chargen[line[vc]*8+rc],cram[vc] & 0x0F,colors[BG0]));
 }
 
 void VIC::draw_background()
 {
+  put8(pout,splat(colors[BG0]));
+}
+
+// background pixels that take part in sprite priority and collisions, set bits in hires and 1x pairs in multicolor
+void VIC::foreground(uint64_t* fg)
+{
+  memset(fg,0,LINE_WORDS*sizeof(uint64_t));
+  int16_t y = rasterline - 0x30 - (current.yctrl & 7);
+  if (!isCanvas || (current.yctrl & 0x10)==0 || y<0 || y>=200) return;
+
+  bool bitmap = current.yctrl & 0x20;
+  bool mc = current.xctrl & 0x10;
+  uint8_t mask = (current.yctrl & 0x40) ? 0x3F : 0xFF;
+  uint16_t v = (y>>3)*40;
+  uint16_t x = SCREEN_BORDER + (current.xctrl & 7);
+  for (int col=0; col<40; ++col, ++v, x+=8)
+  {
+    uint8_t bits = bitmap ? delayed_bitmap[v*8+(y & 7)] : delayed_chargen[(delayed_matrix[v] & mask)*8+(y & 7)];
+    if (mc && (bitmap || (CRAM[v] & 8)))
+      bits = (bits & 0xAA) | ((bits & 0xAA) >> 1);
+    uint64_t m = (uint64_t)bits << 56;
+    fg[x>>6] |= m >> (x & 63);
+    if ((x & 63) > 56) fg[(x>>6)+1] |= m << (64-(x & 63));
+  }
 }
 
-void VIC::draw_sprites()
+uint8_t VIC::fetch_sprites()
 {
+  uint8_t active = 0;
+  for (int i=0; i<8; ++i)
+  {
+    spr[i].active = 0;
+    if ((spren & (1<<i))==0) continue;
+    uint16_t d = rasterline - spr[i].y;
+    if (d >= ((spryexp & (1<<i)) ? 42 : 21)) continue;
+    if (spryexp & (1<<i)) d >>= 1;
+    const uint8_t* data = RAM + base + delayed_matrix[0x3F8+i]*64 + d*3;
+    spr[i].bitmap = (data[0]<<16) | (data[1]<<8) | data[2];
+    spr[i].active = 1;
+    active |= 1<<i;
+  }
+  return active;
+}
+
+void VIC::draw_sprites(uint8_t active, uint8_t* row)
+{
+  if (active == 0) return;
+
+  // expand each sprite once into shift-ready masks: opaque pixels and up to three color planes
+  uint64_t plane[8][3];
+  uint8_t color[8][3];
+  uint64_t opaque[8][2];
+  uint16_t word[8];
+  uint64_t once[LINE_WORDS] = {}, twice[LINE_WORDS] = {};
+  for (int i=0; i<8; ++i)
+  {
+    if ((active & (1<<i))==0) continue;
+    uint32_t bits = spr[i].bitmap;
+    bool expand = sprxexp & (1<<i);
+    if (d01c & (1<<i))
+    {
+      uint32_t lo = bits & 0x555555, hi = (bits>>1) & 0x555555;
+      uint32_t p1 = lo & ~hi, p2 = hi & ~lo, p3 = hi & lo;
+      plane[i][0] = stretch(p1 | (p1<<1),expand);
+      plane[i][1] = stretch(p2 | (p2<<1),expand);
+      plane[i][2] = stretch(p3 | (p3<<1),expand);
+      color[i][0] = colors[SPR_EX1];
+      color[i][1] = colors[SPR0+i];
+      color[i][2] = colors[SPR_EX2];
+    }
+    else
+    {
+      plane[i][0] = stretch(bits,expand);
+      plane[i][1] = plane[i][2] = 0;
+      color[i][0] = colors[SPR0+i];
+    }
+
+    // sprite x 24 is the first canvas pixel
+    uint16_t x = spr[i].x + SCREEN_BORDER - 24;
+    uint64_t m = plane[i][0] | plane[i][1] | plane[i][2];
+    word[i] = x>>6;
+    opaque[i][0] = m >> (x & 63);
+    opaque[i][1] = (x & 63) ? m << (64-(x & 63)) : 0;
+    for (int k=0; k<2; ++k)
+    {
+      twice[word[i]+k] |= once[word[i]+k] & opaque[i][k];
+      once[word[i]+k] |= opaque[i][k];
+    }
+  }
+
+  uint64_t fg[LINE_WORDS];
+  foreground(fg);
+
+  uint8_t ss = 0, sb = 0;
+  for (int i=0; i<8; ++i)
+  {
+    if ((active & (1<<i))==0) continue;
+    uint16_t w = word[i];
+    if ((twice[w] & opaque[i][0]) | (twice[w+1] & opaque[i][1])) ss |= 1<<i;
+    if ((fg[w] & opaque[i][0]) | (fg[w+1] & opaque[i][1])) sb |= 1<<i;
+  }
+  if (ss)
+  {
+    if (regs[0x1e] == 0) { irr |= 4; interrupt(); }
+    regs[0x1e] |= ss;
+  }
+  if (sb)
+  {
+    if (regs[0x1f] == 0) { irr |= 2; interrupt(); }
+    regs[0x1f] |= sb;
+  }
+  if (row == nullptr) return;
+
+  // sprite 0 wins over the others, the winner then goes behind foreground pixels if its priority bit says so
+  uint64_t covered[LINE_WORDS] = {};
+  for (int i=0; i<8; ++i)
+  {
+    if ((active & (1<<i))==0) continue;
+    uint16_t x = spr[i].x + SCREEN_BORDER - 24;
+    for (int k=0; k<2; ++k)
+    {
+      uint16_t w = word[i]+k;
+      uint64_t visible = opaque[i][k] & ~covered[w];
+      covered[w] |= opaque[i][k];
+      if (regs[0x1b] & (1<<i)) visible &= ~fg[w];
+      for (int p=0; p<3; ++p)
+      {
+        uint64_t m = k==0 ? plane[i][p] >> (x & 63) : ((x & 63) ? plane[i][p] << (64-(x & 63)) : 0);
+        paint(row,w,m & visible,color[i][p]);
+      }
+    }
+  }
 }
 
 void VIC::evalDrawMode()
 {
   if (((current.yctrl & 0x10)==0) // den
-  || (((current.yctrl & 8)==0) && ((rastery<8) || (rastery>=(200-8))))
+  || (((current.yctrl & 8)==0) && ((rastery<4) || (rastery>=(200-4)))) // 24 rows
   )
   {
     draw = nullptr; //&VIC::draw_border_color;
     return;
   }
+  if ((current.yctrl & 0x40) && ((current.yctrl & 0x20) || (current.xctrl & 0x10)))
+  {
+    draw = &VIC::draw_void;
+    return;
+  }
   if (current.yctrl & 0x20) // bitmaps
   {
     if (current.xctrl & 0x10) // multicolor
@@ -353,10 +552,134 @@ void VIC::begin(uint16_t y)
   isBorder = false;
 
   if (y == 0x30) DENwasSetInRasterline30 = (current.yctrl & 0x10);
+  plan();
+}
+
+void VIC::plan()
+{
+  cpustall = isCanvas && (current.yctrl & 0x10) && (((rasterline & 0x07) == (current.yctrl & 0x07)) || !DENwasSetInRasterline30);
+}
+
+void VIC::interrupt()
+{
+  cpu.setirq(MC6502::IRQ_VIC, irr & imr);
 }
 
 void VIC::end()
 {
+  if (framebuffer && rasterline>=SCREEN_TOP && rasterline<SCREEN_TOP+SCREEN_HEIGHT) render();
+  else if (spren) draw_sprites(fetch_sprites(),nullptr);
+}
+
+// everything a framebuffer row is rendered from: registers, the graphics of the row and the sprites on it
+uint64_t VIC::signature(bool canvas, bool graphics, uint8_t active)
+{
+  uint64_t h = mix(0x6A09E667F3BCC908ULL,colors[BORDER]);
+  if (canvas)
+  {
+    h = mix(h,current.yctrl | (current.xctrl<<8) | (colors[BG0]<<16) | ((uint64_t)colors[BG1]<<24) | ((uint64_t)colors[BG2]<<32) | ((uint64_t)colors[BG3]<<40));
+    if (graphics) // the invalid modes are black, but their graphics still decide sprite priority
+    {
+      const uint8_t* gfx = (current.yctrl & 0x20) ? delayed_bitmap+rc : delayed_chargen+rc;
+      uint8_t mask = (current.yctrl & 0x40) ? 0x3F : 0xFF;
+      for (uint16_t v=vcbase; v<vcbase+40; v+=8)
+      {
+        uint64_t m,c,g = 0;
+        memcpy(&m,delayed_matrix+v,8);
+        memcpy(&c,CRAM+v,8);
+        if (current.yctrl & 0x20)
+          for (int i=0; i<8; ++i) g = (g<<8) | gfx[(v+i)*8];
+        else
+          for (int i=0; i<8; ++i) g = (g<<8) | gfx[(delayed_matrix[v+i] & mask)*8];
+        h = mix(mix(mix(h,m),c),g);
+      }
+    }
+  }
+  if (active)
+  {
+    h = mix(h,active | (d01c<<8) | (sprxexp<<16) | ((uint64_t)regs[0x1b]<<24) | ((uint64_t)colors[SPR_EX1]<<32) | ((uint64_t)colors[SPR_EX2]<<40));
+    for (int i=0; i<8; ++i)
+      if (active & (1<<i))
+        h = mix(h,spr[i].bitmap | ((uint64_t)spr[i].x<<24) | ((uint64_t)colors[SPR0+i]<<40));
+  }
+  return h;
+}
+
+void VIC::render()
+{
+  uint16_t n = rasterline-SCREEN_TOP;
+  uint8_t* row = framebuffer + n*SCREEN_WIDTH;
+  uint8_t active = spren ? fetch_sprites() : 0;
+  if (isCanvas)
+  {
+    rastery = rasterline-PAL_TOP;
+    evalDrawMode();
+  }
+  bool canvas = isCanvas && draw != nullptr;
+
+  // the character row follows the vertical scroll, lines before the first badline show the background
+  // which stays black in the invalid modes
+  bool invalid = draw == &VIC::draw_void;
+  bool graphics = false;
+  if (canvas)
+  {
+    int16_t y = rasterline - 0x30 - (current.yctrl & 7);
+    graphics = y>=0 && y<200;
+    if (!graphics && !invalid)
+      draw = &VIC::draw_background;
+    vcbase = (y>>3)*40;
+    rc = y & 7;
+    line = delayed_matrix;
+    cram = CRAM;
+  }
+
+  // a row rendered from the same inputs is still in the framebuffer, the sprites still have to collide
+  uint64_t sig = signature(canvas,graphics,active);
+  if (sig == linesig[n])
+  {
+    draw_sprites(active,nullptr);
+    return;
+  }
+  linesig[n] = sig;
+  dirty[n>>3] |= 1<<(n & 7);
+
+  if (!canvas)
+  {
+    draw_sprites(active,nullptr); // behind the border, but they still collide
+    memset(row,colors[BORDER],SCREEN_WIDTH);
+    return;
+  }
+
+  uint8_t xscroll = current.xctrl & 7;
+  memset(row+SCREEN_BORDER,invalid ? 0 : colors[BG0],xscroll);
+  pout = row+SCREEN_BORDER+xscroll;
+  rasterx = xscroll;
+  vc = vcbase;
+  for (int i=0; i<40; ++i) update();
+  draw_sprites(active,row);
+
+  // the side borders cover what the scroll pushed out, 7 and 9 more pixels in 38 column mode
+  uint16_t left = SCREEN_BORDER + ((current.xctrl & 8) ? 0 : 7);
+  uint16_t right = SCREEN_BORDER + ((current.xctrl & 8) ? 320 : 311);
+  memset(row,colors[BORDER],left);
+  memset(row+right,colors[BORDER],SCREEN_WIDTH-right);
+}
+
+void VIC::setup_framebuffer(bool on)
+{
+  if (on && framebuffer == nullptr)
+  {
+    framebuffer = new uint8_t[SCREEN_WIDTH*SCREEN_HEIGHT]();
+    linesig = new uint64_t[SCREEN_HEIGHT]();
+    memset(dirty,0xFF,sizeof(dirty));
+  }
+  else if (!on && framebuffer)
+  {
+    delete[] framebuffer;
+    delete[] linesig;
+    framebuffer = nullptr;
+    linesig = nullptr;
+  }
 }
 
 void VIC::clock()
@@ -367,18 +690,11 @@ void VIC::clock()
     if (unlikely(rasterline == rasterline_irq))
     {
       irr |= 1;
-      if (irr & imr)
-      {
-        cpu.irq();
-      }
+      interrupt();
     }
     break;
     case 17:
-      if (likely(isCanvas))
-      {
-        cpu_is_rdy = ((rasterline & 0x07) != (current.yctrl & 0x07)) && DENwasSetInRasterline30;
-        cpu_is_rdy |= (current.yctrl & 0x10) == 0x00;
-      }
+      cpu_is_rdy = !cpustall;
     break;
     case 57:
       cpu_is_rdy = true;
@@ -386,10 +702,45 @@ void VIC::clock()
   }
 }
 
+uint8_t VIC::nextEvent()
+{
+  // the raster irq, the badline check while one is possible on the canvas and the end of a stall.
+  // Skipping the other cycles only makes the cpu segments longer: the cias follow the cpu's clockcycles
+  // inside a segment, so nothing a program reads depends on where the segments end
+  if (cycle<2 && rasterline==rasterline_irq) return 2;
+  if (cycle<17 && isCanvas) return 17;
+  if (cycle<57 && !cpu_is_rdy) return 57;
+  return CYCLES_PER_RASTERLINE+1;
+}
+
 void VIC::setup()
 {
+  for (int b=0; b<256; ++b)
+  {
+    uint8_t h[8],lo[8],hi[8];
+    for (int i=0; i<8; ++i)
+    {
+      uint8_t pair = (b >> (6-(i & 6))) & 3;
+      h[i] = (b & (0x80>>i)) ? 0xFF : 0x00;
+      lo[i] = (pair & 1) ? 0xFF : 0x00;
+      hi[i] = (pair & 2) ? 0xFF : 0x00;
+    }
+    memcpy(&hires_mask[b],h,8);
+    memcpy(&multi_lo[b],lo,8);
+    memcpy(&multi_hi[b],hi,8);
+    stretch_bits[b] = 0;
+    for (int i=0; i<8; ++i)
+      if (b & (1<<i)) stretch_bits[b] |= 3<<(2*i);
+  }
 }
 
+// the colors as measured by Pepto, the default of most emulators
+const uint32_t VIC::palette[16] =
+{
+  0x000000, 0xFFFFFF, 0x68372B, 0x70A4B2, 0x6F3D86, 0x588D43, 0x352879, 0xB8C76F,
+  0x6F4F25, 0x433900, 0x9A6759, 0x444444, 0x6C6C6C, 0x9AD284, 0x6C5EB5, 0x959595,
+};
+
 void VIC::setup_palette()
 {
 
@@ -403,11 +754,13 @@ void VIC::reset()
   current.yctrl = delayed.yctrl = 0x9B;
   current.xctrl = delayed.xctrl = 0x08;
   mem = 0x14;
-  irr = 0x0f;
+  irr = 0x00;
   sprxexp = 0;
   spryexp = 0;
   spren = 0;
   cpu_is_rdy = true;
+  cpustall = false;
   DENwasSetInRasterline30 = false;
+  interrupt();
   memorymap();
 }
@@ -38,6 +38,12 @@ static const int16_t CYCLES_PER_RASTERLINE = 63;
 static const int16_t RASTERLINES_PER_FRAME = 312;
 static const uint32_t CLOCK_FREQUENCY = CYCLES_PER_RASTERLINE*RASTERLINES_PER_FRAME*(50.125);
 
+// the visible picture: the 320x200 canvas with 32 pixels of border left and right, 36 lines above and below
+static const uint16_t SCREEN_BORDER = 32;
+static const uint16_t SCREEN_WIDTH = SCREEN_BORDER+320+SCREEN_BORDER;
+static const uint16_t SCREEN_TOP = PAL_TOP-36;
+static const uint16_t SCREEN_HEIGHT = 36+200+36;
+
 /*
 static const uint16_t RGB565(uint8_t r, uint8_t g, uint8_t b)
 {
@@ -120,13 +126,16 @@ public:
   uint16_t rasterx; // current x position
   uint16_t rastery;
   uint8_t* pout;
+  uint8_t* framebuffer; // SCREEN_WIDTH*SCREEN_HEIGHT color indices, nullptr while nobody looks at the picture
+  uint64_t* linesig; // per framebuffer row: signature of what it was rendered from
+  uint8_t dirty[(SCREEN_HEIGHT+7)/8]; // framebuffer rows redrawn since the consumer last cleared them
   
-  bool cpustall; // true if vic stalls the CPU, ie badline conditions etc
+  bool cpustall; // true if vic stalls the CPU, ie badline conditions etc, planned by begin()
   bool cpu_is_rdy;
   bool enabled;
   bool DENwasSetInRasterline30;
 
-  // cached: 24 bit sprite bitmap for current line
+  // cached: 24 bit sprite bitmap for current line, filled by draw_sprites()
   struct {
     uint32_t bitmap;
     uint16_t x;
@@ -135,22 +144,33 @@ public:
     uint8_t x2,y2;
   } spr[8];
 
+  static const uint32_t palette[16]; // 0xRRGGBB
   void setup_palette();
 
   void begin(uint16_t y);
+  void plan();
+  void interrupt(); // irq line to the cpu from irr&imr
   inline void update()
   {
     if (draw==nullptr) return;
     (this->*draw)();
-    if (spren) draw_sprites();
     rasterx+=8;
+    pout+=8;
+    ++vc;
   }
 
 
   void end();
+  void render(); // one rasterline into the framebuffer, called by end()
+  uint64_t signature(bool canvas, bool graphics, uint8_t active);
+  void setup_framebuffer(bool on);
   void(VIC::*draw)();
   void evalDrawMode();
   void clock();
+  uint8_t nextEvent(); // next cycle of the rasterline clock() has work to do
+
+  // cycles the cpu can use from the current cycle up to end, none while a badline stalls it
+  inline uint8_t usable(uint8_t end) { return cpu_is_rdy ? end-cycle : 0; }
 
   void setup_cyclefuncs();
   void setup();
@@ -159,7 +179,9 @@ public:
   void reset();
 
   void draw_background();
-  void draw_sprites();
+  uint8_t fetch_sprites(); // the sprites on this line
+  void draw_sprites(uint8_t active, uint8_t* row); // row==nullptr only updates the collision registers
+  void foreground(uint64_t* fg);
   void draw_text_mono();
   void draw_bitmap_mono();
   void draw_text_multicolor();
@@ -169,6 +191,7 @@ public:
   void draw_void();
 
   uint8_t read(uint8_t adr);
+  uint8_t inspect(uint8_t adr) { return (adr==0x1e || adr==0x1f) ? regs[adr] : read(adr); } // without clearing the collisions
   void write(uint8_t adr, uint8_t value);
 
 };